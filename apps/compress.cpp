@@ -0,0 +1,119 @@
+#include "tinyAMR/Model.h"
+#include "tinyAMR/Coverage.h"
+
+void usage(const std::string &error)
+{
+  std::cout << "Error: " << error << "\n\n";
+  std::cout << "Usage: ./tamrCompress inFileName.tamr -o outfile.tamr [options]\n"
+            << "options:\n"
+            << "  --lossless            : lossless compression (default)\n"
+            << "  --abs <field> <bound> : store field lossy, with given absolute error bound\n"
+            << "  --rel <field> <bound> : store field lossy, with given error bound\n"
+            << "                          relative to the field's value range\n"
+            << "  --quantize <field> <fp16|bf16|u8|u16>\n"
+            << "                        : store field in reduced precision\n"
+            << "  --morton|--hilbert    : reorder grids along that space-filling curve\n"
+            << "  --by-level            : store grids level by level\n"
+            << "  --ranges              : also store each grid's value ranges\n"
+            << "  --adjacency           : also store which grids neighbor which\n"
+            << "  --drop-covered        : drop grids that finer grids cover entirely\n"
+            << "  --active-only         : keep only cells that aren't covered by finer grids\n"
+            << "  -j <numThreads>       : number of threads to use\n"
+            << std::endl;
+  exit(1);
+}
+  
+int main(int ac, char **av)
+{
+  using namespace tamr;
+    
+  std::string inFileName;
+  std::string outFileName;
+  IOOptions options;
+  options.compression = IOOptions::COMPRESSION_LOSSLESS;
+  bool compact = false;
+  Coverage::Compaction compaction = Coverage::COMPACT_DROP_COVERED_GRIDS;
+  for (int i=1;i<ac;i++) {
+    const std::string arg = av[i];
+    if (arg[0] != '-')
+      inFileName = arg;
+    else if (arg == "-o" && i+1 < ac) {
+      outFileName = av[++i];
+    } else if (arg == "--lossless") {
+      options.compression = IOOptions::COMPRESSION_LOSSLESS;
+    } else if ((arg == "--abs" || arg == "--rel") && i+2 < ac) {
+      options.compression = IOOptions::COMPRESSION_LOSSY;
+      IOOptions::ErrorBound &bound = options.errorBounds[av[i+1]];
+      bound.value    = std::stof(av[i+2]);
+      bound.relative = (arg == "--rel");
+      i += 2;
+    } else if (arg == "--quantize" && i+2 < ac) {
+      options.compression = IOOptions::COMPRESSION_LOSSY;
+      const std::string format = av[i+2];
+      IOOptions::Quantization &quantization = options.quantizedFields[av[i+1]];
+      if (format == "fp16")
+        quantization = IOOptions::QUANTIZE_FP16;
+      else if (format == "bf16")
+        quantization = IOOptions::QUANTIZE_BF16;
+      else if (format == "u8")
+        quantization = IOOptions::QUANTIZE_UNORM8;
+      else if (format == "u16")
+        quantization = IOOptions::QUANTIZE_UNORM16;
+      else
+        usage("tamrCompress: unknown quantization format '"+format+"'");
+      i += 2;
+    } else if (arg == "--morton") {
+      options.gridOrder = GRID_ORDER_MORTON;
+    } else if (arg == "--hilbert") {
+      options.gridOrder = GRID_ORDER_HILBERT;
+    } else if (arg == "--by-level") {
+      options.groupGridsByLevel = true;
+    } else if (arg == "--ranges") {
+      options.storeValueRanges = true;
+    } else if (arg == "--adjacency") {
+      options.storeGridAdjacency = true;
+    } else if (arg == "--drop-covered") {
+      compact = true;
+      compaction = Coverage::COMPACT_DROP_COVERED_GRIDS;
+    } else if (arg == "--active-only") {
+      compact = true;
+      compaction = Coverage::COMPACT_ACTIVE_CELLS_ONLY;
+    } else if (arg == "-j" && i+1 < ac) {
+      options.numThreads = std::stoi(av[++i]);
+    } else
+      usage("tamrCompress: unknown or incomplete cmdline arg '"+arg+"'");
+  }
+    
+  if (inFileName.empty()) usage("no input file specified");
+  if (outFileName.empty()) usage("no output file specified");
+
+  IOStats loadStats, saveStats;
+  Model::SP model = Model::load(inFileName,options,&loadStats);
+  std::vector<std::string> fieldNames;
+  for (auto &bound : options.errorBounds)
+    fieldNames.push_back(bound.first);
+  for (auto &quantized : options.quantizedFields)
+    fieldNames.push_back(quantized.first);
+  for (auto &fieldName : fieldNames) {
+    bool found = false;
+    for (auto &meta : model->fieldMetas)
+      found |= (meta.name == fieldName);
+    if (!found)
+      usage("no field named '"+fieldName+"' in "+inFileName);
+  }
+  if (compact) {
+    const size_t numGrids = model->grids.size();
+    const uint64_t numCells = model->numCellsAcrossAllGrids;
+    model = Coverage::compute(*model,options.numThreads)->compact(compaction,options.numThreads);
+    std::cout << "compacted " << prettyNumber(numGrids) << " grids with "
+              << prettyNumber(numCells) << " cells to "
+              << prettyNumber(model->grids.size()) << " grids with "
+              << prettyNumber(model->numCellsAcrossAllGrids) << " cells" << std::endl;
+  }
+  model->save(outFileName,options,&saveStats);
+  std::cout << "compressed " << prettyNumber(loadStats.numBytes) << "B to "
+            << prettyNumber(saveStats.numBytes) << "B ("
+            << double(loadStats.numBytes)/std::max(saveStats.numBytes,(uint64_t)1)
+            << "x) in " << saveStats.seconds << "s" << std::endl;
+  return 0;
+}
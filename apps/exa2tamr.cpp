@@ -34,8 +34,7 @@ int main(int ac, char **av)
   if (scalarsFileNames.empty()) usage("no .scalars file(s) specified");
   if (outFileName.empty()) usage("no output file specified");
 
-  Model::SP model = import_exa(cellsFileName,scalarsFileNames);
-  std::cout << "done reading, saving to " << outFileName << std::endl;
-  model->save(outFileName);
+  std::cout << "converting to " << outFileName << std::endl;
+  convert_exa(cellsFileName,scalarsFileNames,outFileName);
   return 0;
 }
@@ -27,8 +27,7 @@ int main(int ac, char **av)
   if (inFileName.empty()) usage("no input file specified");
   if (outFileName.empty()) usage("no output file specified");
 
-  Model::SP model = import_FLASH(inFileName.c_str());
-  std::cout << "done reading, saving to " << outFileName << std::endl;
-  model->save(outFileName);
+  std::cout << "converting to " << outFileName << std::endl;
+  convert_FLASH(inFileName.c_str(),outFileName);
   return 0;
 }
@@ -15,11 +15,16 @@
 // ======================================================================== //
 
 #include "tinyAMR/Model.h"
+#include "tinyAMR/FileFormat.h"
+#include "tinyAMR/ValueRanges.h"
+#include "tinyAMR/Coverage.h"
+#include <fstream>
 
 void usage(const std::string &error)
 {
   std::cout << "Error: " << error << "\n\n";
-  std::cout << "Usage: ./tamrInfo inFileName.tamr" << std::endl;
+  std::cout << "Usage: ./tamrInfo inFileName.tamr [--mmap] [--threads|-j numThreads] [--coverage]\n"
+            << "  --coverage : also count the cells that no finer grid covers" << std::endl;
   exit(1);
 }
 
@@ -28,23 +33,77 @@ int main(int ac, char **av)
   using namespace tamr;
     
   std::string inFileName;
+  bool mapFile = false;
+  bool showCoverage = false;
+  /*! if >= 0, use the parallel loader with this many threads */
+  int numThreads = -1;
   for (int i=1;i<ac;i++) {
     const std::string arg = av[i];
     if (arg[0] != '-') {
       inFileName = arg;
+    } else if (arg == "-m" || arg == "--mmap") {
+      mapFile = true;
+    } else if (arg == "-j" || arg == "--threads") {
+      if (i+1 >= ac) usage("missing argument to '"+arg+"'");
+      numThreads = std::stoi(av[++i]);
+    } else if (arg == "--coverage") {
+      showCoverage = true;
     } else
       usage("tamrinfo: unknown cmdline arg '"+arg+"'");
   }
 
   if (inFileName.empty()) usage("no input file specified");
 
-  tamr::Model::SP model = tamr::Model::load(inFileName);
+  tamr::Model::SP model;
+  if (mapFile) {
+    model = tamr::Model::loadMapped(inFileName);
+  } else if (numThreads >= 0) {
+    IOOptions options;
+    options.numThreads = numThreads;
+    IOStats stats;
+    model = tamr::Model::load(inFileName,options,&stats);
+    std::cout << "loaded " << prettyNumber(stats.numBytes) << "B in "
+              << stats.seconds << "s (" << stats.gbPerSecond() << " GB/s)"
+              << std::endl;
+  } else
+    model = tamr::Model::load(inFileName);
+  // what else the file stores only needs its table of contents
+  std::ifstream in(inFileName,std::ios::binary);
+  const format::Layout layout = format::readLayout(in);
+  const format::Section *timesteps = layout.find(format::SECTION_TIMESTEPS);
+  if (timesteps && timesteps->count > 1)
+    std::cout << "num timesteps " << timesteps->count
+              << " (showing the first one)" << std::endl;
   std::cout << "num grids   " << prettyNumber(model->grids.size()) << std::endl;
   std::cout << "num scalars " << prettyNumber(model->scalars.size()) << std::endl;
+  if (showCoverage) {
+    Coverage::SP coverage = Coverage::compute(*model,std::max(numThreads,0));
+    size_t numCoveredGrids = 0;
+    for (auto count : coverage->numActiveCells)
+      numCoveredGrids += (count == 0);
+    std::cout << "num active cells " << prettyNumber(coverage->totalActiveCells)
+              << " (of " << prettyNumber(model->numCellsAcrossAllGrids)
+              << "; " << prettyNumber(numCoveredGrids) << " grids entirely covered)"
+              << std::endl;
+  }
+  if (const format::Section *adjacency = layout.find(format::SECTION_GRID_ADJACENCY,1))
+    std::cout << "grid adjacency stored, with "
+              << prettyNumber(adjacency->count) << " neighbor entries"
+              << std::endl;
+  std::cout << "cell layout "
+            << (model->cellLayout == CELL_LAYOUT_BRICKED ? "bricked"
+                : model->cellLayout == CELL_LAYOUT_MORTON ? "morton" : "linear")
+            << std::endl;
   std::cout << "num fields  " << prettyNumber(model->fieldMetas.size()) << std::endl;
-  for (auto &meta : model->fieldMetas)
+  for (auto &meta : model->fieldMetas) {
     std::cout << " - '" << meta.name << "' with array offset "
               << prettyNumber(meta.offset) << std::endl;
+    // only if the file stores them; no need to go over all scalars
+    ValueRanges::SP ranges = ValueRanges::load(inFileName,meta.name);
+    for (int dim=0;ranges && dim<ranges->numDimensions;dim++)
+      std::cout << "   - value range" << (ranges->numDimensions > 1 ? "["+std::to_string(dim)+"]" : "")
+                << " " << ranges->overall(dim) << std::endl;
+  }
   std::cout << "num different levels used " << model->refinementOfLevel.size() << std::endl;
   for (int i=0;i<model->refinementOfLevel.size();i++) {
     vec3i dims;
@@ -58,7 +117,7 @@ int main(int ac, char **av)
     std::cout << " - level[" << i << "] : " << std::endl;
     std::cout << "   - refinement is "
               << model->refinementOfLevel[i] << " (-> cell width "
-              << 1.f/(1<<model->refinementOfLevel[i]) << ")" << std::endl;
+              << model->cellWidth(i) << ")" << std::endl;
     std::cout << "   - coordinate bounds on this level " << bounds << std::endl;
     std::cout << "   - last brick on this level has dims " << dims << std::endl;
   }
@@ -27,6 +27,7 @@
 #include <fstream>
 // tamr
 #include "tinyAMR/Model.h"
+#include "tinyAMR/ModelWriter.h"
 
 namespace tamr {
   namespace wholeFile {
@@ -146,9 +147,11 @@ namespace tamr {
       scale. Ie., a cell on level 0 is on the FINEST level, and a cell
       of level 12 is 2^12(=4k) times as wide/big as a level 0 cell -
       and all coords of level-12 (exa-)cells will be in mulitples of
-      4k */
-  Model::SP import_exa(const std::string &cellFileName,
-                       const std::vector<std::string> &scalarsFileNames)
+      4k. This reads the cells file and builds the grids (but no
+      scalars) for those cells; 'cellOffsets[i]' is where in the
+      grids the i'th cell ends up */
+  static Model::SP importGrids(const std::string &cellFileName,
+                               std::vector<int> &cellOffsets)
   {
     std::vector<Cell> cells = wholeFile::readVector<Cell>(cellFileName);
     int maxLevel = 0;
@@ -167,68 +170,105 @@ namespace tamr {
       cell.level = maxLevel - cell.level;
     }
 
-    std::vector<int> cellOffsets;
     Model::SP model = makeGrids(cells,cellOffsets);
     for (int i=0;i<=maxLevel;i++)
       model->refinementOfLevel.push_back((1<<i));
+    return model;
+  }
 
+  /*! the fields to import, each given by the scalar file(s) it gets
+      computed from */
+  static std::vector<std::vector<std::string>>
+  fieldsToImport(const std::vector<std::string> &scalarsFileNames)
+  {
 #if 1
     if (scalarsFileNames.size() == 3) {
       std::cout << "seeing 3 scalars here ... computing vector norm of them" << std::endl;
-      Model::FieldMeta field;
-      field.offset = model->scalars.size();
-      field.numDimensions = 1;
-      field.name = scalarsFileNames[0];
-      model->fieldMetas.push_back(field);
-      
-      std::vector<float> fromFile_x = wholeFile::readVector<float>(scalarsFileNames[0]);
-      std::vector<float> fromFile_y = wholeFile::readVector<float>(scalarsFileNames[1]);
-      std::vector<float> fromFile_z = wholeFile::readVector<float>(scalarsFileNames[2]);
-      std::vector<float> fromFile(fromFile_x.size());
+      return { scalarsFileNames };
+    }
+#endif
+    std::vector<std::vector<std::string>> fields;
+    for (auto fn : scalarsFileNames)
+      fields.push_back({ fn });
+    return fields;
+  }
+
+  /*! reads the scalars of one field - or, if given three files, the
+      norm of the vector field they make up - and reorders them from
+      cell order into grid order */
+  static std::vector<float> readField(const std::vector<std::string> &fileNames,
+                                      const std::vector<int> &cellOffsets)
+  {
+    std::vector<float> fromFile;
+    if (fileNames.size() == 3) {
+      std::vector<float> fromFile_x = wholeFile::readVector<float>(fileNames[0]);
+      std::vector<float> fromFile_y = wholeFile::readVector<float>(fileNames[1]);
+      std::vector<float> fromFile_z = wholeFile::readVector<float>(fileNames[2]);
+      if (fromFile_y.size() != fromFile_x.size() ||
+          fromFile_z.size() != fromFile_x.size())
+        throw std::runtime_error("mismatch of scalars counts of vector components");
+      fromFile.resize(fromFile_x.size());
       for (int i=0;i<fromFile.size();i++) {
         float x = fromFile_x[i];
-        float y = fromFile_x[y];
-        float z = fromFile_x[z];
+        float y = fromFile_y[i];
+        float z = fromFile_z[i];
         fromFile[i] = sqrtf(x*x+y*y+z*z);
       }
-             
-      assert(fromFile.size() == model->numCellsAcrossAllGrids);
+    } else {
+      std::cout << "loading scalars from " << fileNames[0] << std::endl;
+      fromFile = wholeFile::readVector<float>(fileNames[0]);
+    }
 
-      if (fromFile.size() != cellOffsets.size())
-        throw std::runtime_error("mismatch of scalars count and cell count");
-      std::vector<float> reordered(fromFile.size());
-      for (int i=0;i<fromFile.size();i++) {
-        int co = cellOffsets[i];
-        reordered[co] = fromFile[i];
-      }
-      for (auto s : reordered)
-        model->scalars.push_back(s);
-    } else
-#endif
-    for (auto fn : scalarsFileNames) {
+    if (fromFile.size() != cellOffsets.size())
+      throw std::runtime_error("mismatch of scalars count and cell count");
+    std::vector<float> reordered(fromFile.size());
+    for (int i=0;i<fromFile.size();i++) {
+      int co = cellOffsets[i];
+      reordered[co] = fromFile[i];
+    }
+    return reordered;
+  }
+  
+  Model::SP import_exa(const std::string &cellFileName,
+                       const std::vector<std::string> &scalarsFileNames)
+  {
+    std::vector<int> cellOffsets;
+    Model::SP model = importGrids(cellFileName,cellOffsets);
+    for (auto &fileNames : fieldsToImport(scalarsFileNames)) {
       Model::FieldMeta field;
       field.offset = model->scalars.size();
       field.numDimensions = 1;
-      field.name = fn;
+      field.name = fileNames[0];
       model->fieldMetas.push_back(field);
       
-      std::cout << "loading scalars from " << fn << std::endl;
-      std::vector<float> fromFile = wholeFile::readVector<float>(fn);
-      assert(fromFile.size() == model->numCellsAcrossAllGrids);
-
-      if (fromFile.size() != cellOffsets.size())
-        throw std::runtime_error("mismatch of scalars count and cell count");
-      std::vector<float> reordered(fromFile.size());
-      for (int i=0;i<fromFile.size();i++) {
-        int co = cellOffsets[i];
-        reordered[co] = fromFile[i];
-      }
-      for (auto s : reordered)
+      for (auto s : readField(fileNames,cellOffsets))
         model->scalars.push_back(s);
     }
     
     return model;
   }
 
+  void convert_exa(const std::string &cellFileName,
+                   const std::vector<std::string> &scalarsFileNames,
+                   const std::string &outFileName)
+  {
+    std::vector<int> cellOffsets;
+    Model::SP model = importGrids(cellFileName,cellOffsets);
+    std::vector<std::vector<std::string>> fields = fieldsToImport(scalarsFileNames);
+    std::vector<Model::FieldMeta> fieldMetas(fields.size());
+    for (size_t i=0;i<fields.size();i++)
+      fieldMetas[i].name = fields[i][0];
+
+    ModelWriter writer(outFileName,fieldMetas);
+    writer.refinementOfLevel = model->refinementOfLevel;
+    for (auto &grid : model->grids)
+      writer.addGrid(grid);
+    for (size_t i=0;i<fields.size();i++) {
+      std::vector<float> scalars = readField(fields[i],cellOffsets);
+      writer.addScalars((int)i,scalars.data(),scalars.size());
+    }
+    writer.close();
+  }
+
 } // ::tamr
 
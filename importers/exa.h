@@ -22,5 +22,13 @@ namespace tamr {
 
   Model::SP import_exa(const std::string &cellFileName,
                        const std::vector<std::string> &scalarsFileName);
+
+  /*! same as import_exa, but streams the result into the given
+      .tamr file (through a ModelWriter) rather than building the
+      entire model in memory; at most one field's scalars are in
+      memory at any time */
+  void convert_exa(const std::string &cellFileName,
+                   const std::vector<std::string> &scalarsFileName,
+                   const std::string &outFileName);
   
 }
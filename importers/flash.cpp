@@ -28,6 +28,7 @@
 #include <H5Cpp.h>
 // tamr
 #include "tinyAMR/Model.h"
+#include "tinyAMR/ModelWriter.h"
 
 namespace tamr {
 
@@ -261,6 +262,42 @@ namespace tamr {
                  dataspace);
   }
 
+  /*! same as read_variable, but only reads the variable's
+      dimensions, not its data */
+  inline void read_variable_info(variable_t &var, H5::H5File const &file, char const *varname)
+  {
+    H5::DataSet dataset = file.openDataSet(varname);
+    H5::DataSpace dataspace = dataset.getSpace();
+
+    hsize_t dims[4];
+    dataspace.getSimpleExtentDims(dims);
+    var.global_num_grids = dims[0];
+    var.nxb = dims[1];
+    var.nyb = dims[2];
+    var.nzb = dims[3];
+  }
+
+  /*! reads the data of blocks [firstBlock,firstBlock+numBlocks) of
+      given variable into 'data' */
+  inline void read_variable_blocks(std::vector<double> &data,
+                                   const variable_t &var,
+                                   H5::H5File const &file, char const *varname,
+                                   size_t firstBlock, size_t numBlocks)
+  {
+    H5::DataSet dataset = file.openDataSet(varname);
+    H5::DataSpace fileSpace = dataset.getSpace();
+
+    hsize_t start[4] = { firstBlock, 0, 0, 0 };
+    hsize_t count[4] = { numBlocks, var.nxb, var.nyb, var.nzb };
+    fileSpace.selectHyperslab(H5S_SELECT_SET,count,start);
+    H5::DataSpace memSpace(4,count);
+    data.resize(numBlocks * var.nxb * var.nyb * var.nzb);
+    dataset.read(data.data(),
+                 H5::PredType::NATIVE_DOUBLE,
+                 memSpace,
+                 fileSpace);
+  }
+
 #if 0
   inline AMRField toAMRField(const grid_t &grid,
                              const variable_t &var)
@@ -606,5 +643,61 @@ namespace tamr {
     // return model;
   }
 
+  void convert_FLASH(const char *filepath,
+                     const std::string &outFileName,
+                     int fieldIndex,
+                     size_t bufferSize)
+  {
+    FlashReader reader;
+    if (!reader.open(filepath)) {
+      throw std::runtime_error
+        ("[import_FLASH] failed to open file '"+std::string(filepath)+"'");
+    }
+    
+    try {
+      variable_t currentField;
+      std::string fieldName = reader.fieldNames[fieldIndex];
+      printf("[import_FLASH] streaming field '%s'...\n", fieldName.c_str());
+      read_variable_info(currentField, reader.file, fieldName.c_str());
+
+      // this only builds the grids, without any scalars
+      Model::SP model = std::make_shared<Model>();
+      importFlash(model,reader.grid,currentField);
+
+      std::vector<Model::FieldMeta> fieldMetas(1);
+      fieldMetas[0].name = fieldName;
+      ModelWriter writer(outFileName,fieldMetas,bufferSize);
+      writer.refinementOfLevel = model->refinementOfLevel;
+      writer.userMeta = filepath;
+      for (auto &grid : model->grids)
+        writer.addGrid(grid);
+
+      // read blocks in batches that (together with their converted
+      // floats) fit into the buffer size
+      const size_t cellsPerBlock
+        = currentField.nxb * currentField.nyb * currentField.nzb;
+      const size_t blocksPerBatch
+        = std::max(size_t(1),bufferSize/(cellsPerBlock*(sizeof(double)+sizeof(float))));
+      std::vector<double> data;
+      std::vector<float>  scalars;
+      for (size_t begin=0;begin<currentField.global_num_grids;begin+=blocksPerBatch) {
+        size_t numBlocks = std::min(blocksPerBatch,currentField.global_num_grids-begin);
+        read_variable_blocks(data,currentField,reader.file,fieldName.c_str(),
+                             begin,numBlocks);
+        scalars.resize(data.size());
+        for (size_t i=0;i<data.size();i++)
+          scalars[i] = log(data[i]);
+        writer.addScalars(0,scalars.data(),scalars.size());
+      }
+      writer.close();
+    } catch (const H5::DataSpaceIException &error) {
+      error.printErrorStack();
+      exit(EXIT_FAILURE);
+    } catch (const H5::DataTypeIException &error) {
+      error.printErrorStack();
+      exit(EXIT_FAILURE);
+    }
+  }
+
 } // ::tamr
 
@@ -21,5 +21,14 @@
 namespace tamr {
 
   Model::SP import_FLASH(const char *filepath, int fieldIndex=0);
+
+  /*! same as import_FLASH, but streams the result into the given
+      .tamr file (through a ModelWriter), reading the FLASH file in
+      batches of blocks that fit into 'bufferSize' bytes, rather than
+      building the entire model in memory */
+  void convert_FLASH(const char *filepath,
+                     const std::string &outFileName,
+                     int fieldIndex=0,
+                     size_t bufferSize=256ull<<20);
   
 }
@@ -0,0 +1,98 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <initializer_list>
+
+namespace tamr {
+
+  /*! a contiguous array of T's that behaves like (the subset of) a
+      std::vector that this library and its importers use, but that
+      can alternatively also be a *view* into memory owned by someone
+      else - typically a memory-mapped file (see
+      Model::loadMapped()). A view keeps whatever owns that memory
+      alive for as long as the view (or any copy of it) exists;
+      writing to a view's elements is allowed, but any operation
+      that changes the array's size will first turn the view into an
+      owned copy of its elements. */
+  template<typename T>
+  struct Array {
+    typedef T        value_type;
+    typedef T       *iterator;
+    typedef const T *const_iterator;
+
+    Array() = default;
+    Array(const std::vector<T> &vec) : owned(vec) {}
+    Array(std::vector<T> &&vec) : owned(std::move(vec)) {}
+    Array(std::initializer_list<T> init) : owned(init) {}
+
+    /*! create a view onto 'count' elements starting at 'begin';
+        'keepAlive' is whatever owns this memory */
+    static Array view(T *begin, size_t count, std::shared_ptr<void> keepAlive)
+    {
+      Array array;
+      array.viewBegin = begin;
+      array.viewSize  = count;
+      array.keepAlive = keepAlive;
+      return array;
+    }
+
+    /*! whether this array is a view into somebody else's memory */
+    bool isView() const { return (bool)keepAlive; }
+
+    size_t size()  const { return isView() ? viewSize : owned.size(); }
+    bool   empty() const { return size() == 0; }
+
+    T       *data()       { return isView() ? viewBegin : owned.data(); }
+    const T *data() const { return isView() ? viewBegin : owned.data(); }
+
+    T       &operator[](size_t i)       { return data()[i]; }
+    const T &operator[](size_t i) const { return data()[i]; }
+
+    T       &back()       { return data()[size()-1]; }
+    const T &back() const { return data()[size()-1]; }
+
+    iterator       begin()       { return data(); }
+    iterator       end()         { return data()+size(); }
+    const_iterator begin() const { return data(); }
+    const_iterator end()   const { return data()+size(); }
+
+    void push_back(const T &t)  { makeOwned(); owned.push_back(t); }
+    void resize(size_t newSize) { makeOwned(); owned.resize(newSize); }
+    void reserve(size_t n)      { makeOwned(); owned.reserve(n); }
+    void clear()                { keepAlive.reset(); owned.clear(); }
+
+  private:
+    /*! if this is a view, replace it with an owned copy of its elements */
+    void makeOwned()
+    {
+      if (!isView()) return;
+      owned.assign(viewBegin,viewBegin+viewSize);
+      keepAlive.reset();
+      viewBegin = nullptr;
+      viewSize  = 0;
+    }
+
+    std::vector<T>        owned;
+    T                    *viewBegin = nullptr;
+    size_t                viewSize  = 0;
+    std::shared_ptr<void> keepAlive;
+  };
+
+} // ::tamr
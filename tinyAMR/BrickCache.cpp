@@ -0,0 +1,217 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/BrickCache.h"
+
+namespace tamr {
+  using namespace tamr::format;
+
+  inline uint64_t numCellsOf(const Model::Grid &grid)
+  { return uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z; }
+
+  BrickCache::Span::Span(Span &&other)
+  {
+    *this = std::move(other);
+  }
+
+  BrickCache::Span &BrickCache::Span::operator=(Span &&other)
+  {
+    if (this == &other) return *this;
+    if (cache) cache->unpin(gridID);
+    cache    = other.cache;
+    gridID   = other.gridID;
+    data     = other.data;
+    numCells = other.numCells;
+    other.cache = nullptr;
+    other.data  = nullptr;
+    return *this;
+  }
+
+  BrickCache::Span::~Span()
+  {
+    if (cache) cache->unpin(gridID);
+  }
+
+  const float *BrickCache::Span::scalars(int field, int dim) const
+  {
+    const size_t stream = cache->firstStreamOfField[field]+dim;
+    return data + stream*numCells;
+  }
+
+  BrickCache::BrickCache(const std::string &fileName,
+                         size_t memoryBudget,
+                         const std::vector<std::string> &fieldNames)
+    : in(fileName,std::ios::binary),
+      memoryBudget(memoryBudget)
+  {
+    if (!in.good())
+      throw std::runtime_error("tamr::BrickCache: could not open '"+fileName+"'");
+    layout = readLayout(in);
+    meta = readMetaData(in,layout);
+    readSection(in,layout.get(SECTION_GRIDS),grids);
+    if (!in.good())
+      throw std::runtime_error("tamr::BrickCache: error reading grids");
+    scalars = std::make_unique<ScalarReader>(in,layout.get(SECTION_SCALARS));
+
+    std::vector<Model::FieldMeta> allFields = meta->fieldMetas;
+    std::vector<int> fieldIDs;
+    if (fieldNames.empty()) {
+      for (int i=0;i<(int)allFields.size();i++)
+        fieldIDs.push_back(i);
+    } else {
+      for (auto &name : fieldNames) {
+        int fieldID = -1;
+        for (int i=0;i<(int)allFields.size();i++)
+          if (allFields[i].name == name) { fieldID = i; break; }
+        if (fieldID < 0)
+          throw std::runtime_error("tamr::BrickCache: file '"+fileName
+                                   +"' does not contain a field named '"+name+"'");
+        fieldIDs.push_back(fieldID);
+      }
+    }
+
+    meta->fieldMetas.clear();
+    for (int fieldID : fieldIDs) {
+      const Section &range = layout.get(SECTION_FIELD_SCALARS,fieldID);
+      firstStreamOfField.push_back(streamBase.size());
+      for (int dim=0;dim<allFields[fieldID].numDimensions;dim++)
+        streamBase.push_back(range.begin+dim*meta->numCellsAcrossAllGrids);
+      meta->fieldMetas.push_back(allFields[fieldID]);
+    }
+  }
+
+  BrickCache::Span BrickCache::get(size_t gridID)
+  {
+    if (gridID >= grids.size())
+      throw std::runtime_error("tamr::BrickCache: invalid grid ID");
+    const Model::Grid &grid = grids[gridID];
+    const uint64_t numCells = numCellsOf(grid);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = bricks.find(gridID);
+    if (it != bricks.end()) {
+      numHits++;
+      Brick &brick = it->second;
+      if (brick.pinCount++ == 0 && !brick.loading && !brick.failed)
+        lru.erase(brick.lruPos);
+      loaded.wait(lock,[&]() { return !brick.loading; });
+      if (brick.failed) {
+        unpinLocked(gridID);
+        throw std::runtime_error("tamr::BrickCache: error reading scalars");
+      }
+      Span span;
+      span.cache    = this;
+      span.gridID   = gridID;
+      span.numCells = numCells;
+      span.data     = brick.data.data();
+      return span;
+    }
+
+    // reserve the space and pin the brick, then read it without
+    // holding the lock; bricks don't move in the map, so 'brick'
+    // stays valid
+    numMisses++;
+    const size_t numStreams = streamBase.size();
+    const size_t brickBytes = numCells*numStreams*sizeof(float);
+    makeSpaceFor(brickBytes);
+    Brick &brick = bricks[gridID];
+    brick.pinCount = 1;
+    brick.loading  = true;
+    numBytes += brickBytes;
+    lock.unlock();
+
+    std::vector<float> data;
+    bool ok = true;
+    try {
+      data.resize(numCells*numStreams);
+      std::lock_guard<std::mutex> fileLock(fileMutex);
+      for (size_t stream=0;stream<numStreams;stream++)
+        scalars->read(streamBase[stream]+grid.offset,numCells,
+                      data.data()+stream*numCells);
+      ok = in.good();
+    } catch (...) {
+      ok = false;
+    }
+
+    lock.lock();
+    brick.loading = false;
+    if (!ok) {
+      brick.failed = true;
+      loaded.notify_all();
+      unpinLocked(gridID);
+      throw std::runtime_error("tamr::BrickCache: error reading scalars");
+    }
+    brick.data.swap(data);
+    loaded.notify_all();
+
+    Span span;
+    span.cache    = this;
+    span.gridID   = gridID;
+    span.numCells = numCells;
+    span.data     = brick.data.data();
+    return span;
+  }
+
+  void BrickCache::unpinLocked(size_t gridID)
+  {
+    auto it = bricks.find(gridID);
+    if (it == bricks.end()) return;
+    Brick &brick = it->second;
+    if (--brick.pinCount > 0) return;
+    if (brick.failed) {
+      // nobody uses it any more; the next get() can try again
+      numBytes -= numCellsOf(grids[gridID])*streamBase.size()*sizeof(float);
+      bricks.erase(it);
+      return;
+    }
+    brick.lruPos = lru.insert(lru.begin(),gridID);
+    makeSpaceFor(0);
+  }
+
+  void BrickCache::unpin(size_t gridID)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    unpinLocked(gridID);
+  }
+
+  void BrickCache::makeSpaceFor(size_t numBytesNeeded)
+  {
+    while (!lru.empty() && numBytes+numBytesNeeded > memoryBudget) {
+      auto it = bricks.find(lru.back());
+      numBytes -= it->second.data.size()*sizeof(float);
+      bricks.erase(it);
+      lru.pop_back();
+    }
+  }
+
+  void BrickCache::clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t gridID : lru) {
+      auto it = bricks.find(gridID);
+      numBytes -= it->second.data.size()*sizeof(float);
+      bricks.erase(it);
+    }
+    lru.clear();
+  }
+
+  size_t BrickCache::bytesInMemory() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numBytes;
+  }
+
+} // ::tamr
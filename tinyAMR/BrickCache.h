@@ -0,0 +1,148 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/FileFormat.h"
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+
+namespace tamr {
+
+  /*! random access to the scalars of a .tamr file that may be much
+      larger than memory: all grids are kept in memory, but each
+      grid's scalars get read from the file only when asked for, and
+      are kept in memory only as long as they fit into a fixed memory
+      budget, dropping the least recently used grids first. Grids
+      whose scalars are currently in use ("pinned") never get
+      dropped. Typical use:
+
+      BrickCache cache(fileName,16ull<<30);
+      for (size_t gridID : gridsToProcess) {
+        BrickCache::Span span = cache.get(gridID);
+        process(cache.grids[gridID],span.scalars());
+      }
+
+      All methods can be called from multiple threads at once. Reads
+      from the file are serialized, but don't block get()s of grids
+      that are already in memory; threads asking for a grid that
+      another thread is still reading wait for that read. */
+  struct BrickCache {
+    typedef std::shared_ptr<BrickCache> SP;
+
+    /*! the scalars of one grid; they stay in memory (and valid) at
+        least as long as the span they were returned in exists */
+    struct Span {
+      Span() = default;
+      Span(Span &&other);
+      Span &operator=(Span &&other);
+      Span(const Span &) = delete;
+      Span &operator=(const Span &) = delete;
+      /*! unpins the grid's scalars */
+      ~Span();
+
+      /*! the grid's scalars of the given field (counted among the
+          fields the cache was asked to read) and dimension of that
+          field; in the same order as in Model::scalars */
+      const float *scalars(int field=0, int dim=0) const;
+
+      uint64_t numCells = 0;
+
+    private:
+      friend struct BrickCache;
+      BrickCache  *cache  = nullptr;
+      size_t       gridID = 0;
+      const float *data   = nullptr;
+    };
+
+    /*! opens given file for reading the given fields (or all fields
+        if 'fieldNames' is empty), keeping at most 'memoryBudget'
+        bytes of scalars in memory. The budget may be exceeded only if
+        there are more grids pinned at the same time than fit into
+        it. */
+    BrickCache(const std::string &fileName,
+               size_t memoryBudget,
+               const std::vector<std::string> &fieldNames = {});
+
+    /*! returns the scalars of given grid, reading them from the file
+        if they aren't in memory */
+    Span get(size_t gridID);
+
+    /*! drops all scalars that aren't pinned */
+    void clear();
+
+    /*! memory used by the scalars currently in memory, in bytes */
+    size_t bytesInMemory() const;
+
+    /*! everything about the model except its grids and scalars; its
+        fieldMetas are the ones this cache reads, in the order spans
+        store them in */
+    Model::SP          meta;
+
+    /*! all grids of the file, exactly as stored in the file */
+    Array<Model::Grid> grids;
+
+    /*! number of get()s that did, and didn't, find the scalars in
+        memory */
+    std::atomic<size_t> numHits   { 0 };
+    std::atomic<size_t> numMisses { 0 };
+
+  private:
+    struct Brick {
+      std::vector<float> data;
+      int                pinCount = 0;
+      /*! whether some thread is still reading this brick's scalars
+          (or failed to); either way 'data' isn't valid yet */
+      bool               loading  = false;
+      bool               failed   = false;
+      /*! position in 'lru'; only valid while not pinned */
+      std::list<size_t>::iterator lruPos;
+    };
+
+    /*! drops one pin of given grid's brick; with 'mutex' locked */
+    void unpinLocked(size_t gridID);
+    void unpin(size_t gridID);
+
+    /*! drops unpinned bricks, least recently used first, until
+        there's space for 'numBytes' more */
+    void makeSpaceFor(size_t numBytes);
+
+    std::ifstream            in;
+    format::Layout           layout;
+    std::unique_ptr<format::ScalarReader> scalars;
+    /*! serializes all reads through 'in' and 'scalars' */
+    std::mutex               fileMutex;
+    /*! for each stream (ie, each dimension of each field read), the
+        index in the file's scalars section of its first scalar */
+    std::vector<uint64_t>    streamBase;
+    std::vector<size_t>      firstStreamOfField;
+    const size_t             memoryBudget;
+
+    mutable std::mutex       mutex;
+    /*! signaled whenever a brick is done loading */
+    std::condition_variable  loaded;
+    std::unordered_map<size_t,Brick> bricks;
+    /*! IDs of all unpinned grids whose scalars are in memory, most
+        recently used first */
+    std::list<size_t>        lru;
+    size_t                   numBytes = 0;
+  };
+
+} // ::tamr
@@ -0,0 +1,121 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! \file CellLayout.h the order that a grid's cells' scalars are
+    stored in.
+
+    Whatever the layout, a grid with N=Nx*Ny*Nz cells always has
+    exactly N scalars (per field dimension), starting at grid.offset;
+    only the order of these N scalars differs:
+
+    - CELL_LAYOUT_LINEAR: cell (x,y,z) is at x+Nx*(y+Ny*z), ie, in
+      z-major order; this is the default, and what all importers
+      write.
+
+    - CELL_LAYOUT_BRICKED: cells are grouped into bricks of 4x4x4
+      cells (smaller bricks at the grid's upper boundaries if the
+      grid's dims aren't multiples of 4); bricks are stored in
+      z-major order, and so are the cells within each brick. So all
+      64 cells of any 4^3 neighborhood are in one 256-byte block.
+
+    - CELL_LAYOUT_MORTON: cells are in Morton (Z-curve) order, with
+      any codes that'd be outside the grid skipped. For grids whose
+      dims are the same power of two this is just the Morton code of
+      the cell; for all other grids computing the index is somewhat
+      more expensive. */
+
+#pragma once
+
+#include "tinyAMR/common.h"
+#include "tinyAMR/SpaceFillingCurve.h"
+
+namespace tamr {
+
+  typedef enum : uint32_t {
+    CELL_LAYOUT_LINEAR = 0,
+    CELL_LAYOUT_BRICKED,
+    CELL_LAYOUT_MORTON,
+  } CellLayout;
+
+  /*! width of the bricks of CELL_LAYOUT_BRICKED */
+  const int cellBrickSize = 4;
+
+  inline uint64_t linearCellIndex(const vec3i &dims, const vec3i &cell)
+  {
+    return cell.x + uint64_t(dims.x)*(cell.y + uint64_t(dims.y)*cell.z);
+  }
+
+  inline uint64_t brickedCellIndex(const vec3i &dims, const vec3i &cell)
+  {
+    const int B = cellBrickSize;
+    const vec3i brick = cell/B;
+    const vec3i inBrick = cell - brick*B;
+    // size of the brick this cell is in
+    const vec3i size = min(vec3i(B),dims-brick*B);
+    // all cells in slabs of bricks below this one, then in rows of
+    // bricks below this one within that slab, then in the bricks to
+    // the left within that row
+    return uint64_t(B)*brick.z*dims.x*dims.y
+      +    uint64_t(B)*brick.y*dims.x*size.z
+      +    uint64_t(B)*brick.x*size.y*size.z
+      +    inBrick.x + size.x*(inBrick.y + size.y*inBrick.z);
+  }
+
+  inline uint64_t mortonCellIndex(const vec3i &dims, const vec3i &cell)
+  {
+    int bits = 0;
+    while ((1<<bits) < reduce_max(dims)) bits++;
+    if (dims.x == (1<<bits) && dims.y == dims.x && dims.z == dims.x)
+      return mortonCode3(cell.x,cell.y,cell.z);
+
+    // count all cells inside the grid whose Morton code is smaller
+    // than this cell's, by going down the octree of the (power of
+    // two sized) cube around the grid, adding the number of grid cells
+    // in all children that come before the one that has the cell
+    uint64_t index = 0;
+    vec3i lower(0);
+    for (int level=bits-1;level>=0;--level) {
+      const int half = 1<<level;
+      const int childOfCell
+        = ((cell.x >> level) & 1)
+        | (((cell.y >> level) & 1) << 1)
+        | (((cell.z >> level) & 1) << 2);
+      for (int child=0;child<childOfCell;child++) {
+        const vec3i childLower
+          = lower + vec3i(child & 1, (child >> 1) & 1, (child >> 2) & 1)*half;
+        const vec3i extent = max(vec3i(0),min(dims,childLower+vec3i(half))-childLower);
+        index += uint64_t(extent.x)*extent.y*extent.z;
+      }
+      lower = lower + vec3i(childOfCell & 1, (childOfCell >> 1) & 1, (childOfCell >> 2) & 1)*half;
+    }
+    return index;
+  }
+
+  /*! index of given cell among the scalars of a grid with given dims
+      (ie, relative to grid.offset), in given layout */
+  inline uint64_t cellIndex(CellLayout layout, const vec3i &dims, const vec3i &cell)
+  {
+    switch (layout) {
+    case CELL_LAYOUT_BRICKED:
+      return brickedCellIndex(dims,cell);
+    case CELL_LAYOUT_MORTON:
+      return mortonCellIndex(dims,cell);
+    default:
+      return linearCellIndex(dims,cell);
+    }
+  }
+
+} // ::tamr
@@ -0,0 +1,670 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/Compression.h"
+#include "tinyAMR/QuantizedField.h"
+#include "tinyAMR/parallel_for.h"
+#include <cstring>
+#include <cmath>
+
+namespace tamr {
+  namespace format {
+
+    /*! the LZ stage stores a sequence of (literal run, match) pairs,
+        each as
+
+          varint numLiterals, literals,
+          varint matchOffset, varint (matchLength-minMatch)
+
+        where the final pair only has the literals part; the decoder
+        knows the output size, so it knows when that is reached */
+    const int      minMatch   = 4;
+    const int      hashBits   = 14;
+
+    inline void writeVarint(std::string &out, uint64_t value)
+    {
+      while (value >= 0x80) {
+        out.push_back(char(value | 0x80));
+        value >>= 7;
+      }
+      out.push_back(char(value));
+    }
+
+    inline uint64_t readVarint(const uint8_t *&in, const uint8_t *end)
+    {
+      uint64_t value = 0;
+      for (int shift=0;shift<64;shift+=7) {
+        if (in >= end)
+          throw std::runtime_error("tamr: corrupt compressed chunk");
+        uint8_t byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+      }
+      throw std::runtime_error("tamr: corrupt compressed chunk");
+    }
+
+    inline uint32_t load32(const uint8_t *ptr)
+    { uint32_t v; memcpy(&v,ptr,4); return v; }
+
+    inline uint32_t hash32(uint32_t v)
+    { return (v * 2654435761u) >> (32-hashBits); }
+
+    /*! greedy LZ77 with a single-entry hash table */
+    static void compressLZ(const uint8_t *in, size_t size, std::string &out)
+    {
+      std::vector<uint32_t> table(1<<hashBits,0);
+      size_t literalBegin = 0;
+      size_t pos = 0;
+      while (pos+minMatch <= size) {
+        const uint32_t v = load32(in+pos);
+        uint32_t &entry = table[hash32(v)];
+        // table entries are stored +1, so 0 means 'empty'
+        const size_t candidate = entry;
+        entry = uint32_t(pos+1);
+        if (candidate == 0 || load32(in+candidate-1) != v) { pos++; continue; }
+
+        const size_t matchBegin = candidate-1;
+        size_t length = minMatch;
+        while (pos+length < size && in[matchBegin+length] == in[pos+length])
+          length++;
+        writeVarint(out,pos-literalBegin);
+        out.append((const char *)in+literalBegin,pos-literalBegin);
+        writeVarint(out,pos-matchBegin);
+        writeVarint(out,length-minMatch);
+        pos += length;
+        literalBegin = pos;
+      }
+      writeVarint(out,size-literalBegin);
+      out.append((const char *)in+literalBegin,size-literalBegin);
+    }
+
+    static void decompressLZ(const uint8_t *in, size_t inSize,
+                             uint8_t *out, size_t outSize)
+    {
+      const uint8_t *inEnd = in + inSize;
+      size_t pos = 0;
+      while (true) {
+        const uint64_t numLiterals = readVarint(in,inEnd);
+        if (numLiterals > outSize-pos || numLiterals > uint64_t(inEnd-in))
+          throw std::runtime_error("tamr: corrupt compressed chunk");
+        memcpy(out+pos,in,numLiterals);
+        in  += numLiterals;
+        pos += numLiterals;
+        if (pos == outSize) return;
+
+        const uint64_t offset = readVarint(in,inEnd);
+        const uint64_t length = readVarint(in,inEnd)+minMatch;
+        if (offset == 0 || offset > pos || length > outSize-pos)
+          throw std::runtime_error("tamr: corrupt compressed chunk");
+        // matches may overlap their own output, so copy bytewise
+        for (uint64_t i=0;i<length;i++)
+          out[pos+i] = out[pos-offset+i];
+        pos += length;
+      }
+    }
+
+    /*! XOR-delta plus byte shuffle: byte plane 'b' holds byte 'b' of
+        every (delta'ed) scalar */
+    static void shuffle(const float *scalars, uint64_t count, uint8_t *planes)
+    {
+      uint32_t prev = 0;
+      for (uint64_t i=0;i<count;i++) {
+        uint32_t bits;
+        memcpy(&bits,scalars+i,4);
+        const uint32_t delta = bits ^ prev;
+        prev = bits;
+        for (int b=0;b<4;b++)
+          planes[b*count+i] = uint8_t(delta >> (8*b));
+      }
+    }
+
+    static void unshuffle(const uint8_t *planes, uint64_t count, float *scalars)
+    {
+      uint32_t prev = 0;
+      for (uint64_t i=0;i<count;i++) {
+        uint32_t delta = 0;
+        for (int b=0;b<4;b++)
+          delta |= uint32_t(planes[b*count+i]) << (8*b);
+        prev ^= delta;
+        memcpy(scalars+i,&prev,4);
+      }
+    }
+
+    inline uint32_t zigzag(int32_t v)
+    { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+
+    inline int32_t unzigzag(uint32_t v)
+    { return int32_t(v >> 1) ^ -int32_t(v & 1); }
+
+    /*! CHUNK_LORENZO chunks quantize each scalar's prediction error
+        to an integer multiple of twice the error bound; the codes
+        (zigzag'ed and plus one, with zero meaning 'not predictable,
+        stored as float') get bit-packed in blocks of this many, each
+        block with its own bit width */
+    const int lorenzoBlockSize = 64;
+
+    /*! plain old data, so it can be memcpy'ed in and out of chunks */
+    struct LorenzoHeader {
+      int32_t  dims[3];
+      float    errorBound;
+      uint32_t numOutliers;
+    };
+
+    /*! 3D Lorenzo predictor: predicts a scalar from the seven
+        already (de-)coded scalars of the cube 'behind' it */
+    inline double lorenzo(const float *v, const vec3i &dims, int x, int y, int z)
+    {
+      const int64_t sx = 1, sy = dims.x, sz = int64_t(dims.x)*dims.y;
+      const float *p = v + x*sx + y*sy + z*sz;
+      double pred = 0.;
+      if (x) pred += p[-sx];
+      if (y) pred += p[-sy];
+      if (z) pred += p[-sz];
+      if (x && y) pred -= p[-sx-sy];
+      if (x && z) pred -= p[-sx-sz];
+      if (y && z) pred -= p[-sy-sz];
+      if (x && y && z) pred += p[-sx-sy-sz];
+      return pred;
+    }
+
+    static std::string encodeLorenzo(const float *scalars, const vec3i &dims, float errorBound)
+    {
+      const uint64_t count = uint64_t(dims.x)*dims.y*dims.z;
+      const double quantum = 2.*errorBound;
+      std::vector<float>    recon(count);
+      std::vector<uint32_t> codes(count);
+      std::vector<float>    outliers;
+      uint64_t i = 0;
+      for (int z=0;z<dims.z;z++)
+        for (int y=0;y<dims.y;y++)
+          for (int x=0;x<dims.x;x++,i++) {
+            const double pred = lorenzo(recon.data(),dims,x,y,z);
+            const double q = std::round((double(scalars[i])-pred)/quantum);
+            if (std::isfinite(scalars[i]) && std::fabs(q) < double(1<<30)) {
+              // check the bound on what the decoder will actually
+              // compute, which is in float
+              const float r = float(pred + q*quantum);
+              if (std::fabs(double(r)-double(scalars[i])) <= errorBound) {
+                codes[i] = zigzag(int32_t(q))+1;
+                recon[i] = r;
+                continue;
+              }
+            }
+            codes[i] = 0;
+            recon[i] = scalars[i];
+            outliers.push_back(scalars[i]);
+          }
+
+      LorenzoHeader header;
+      header.dims[0]     = dims.x;
+      header.dims[1]     = dims.y;
+      header.dims[2]     = dims.z;
+      header.errorBound  = errorBound;
+      header.numOutliers = (uint32_t)outliers.size();
+      std::string out(1,char(CHUNK_LORENZO));
+      out.append((const char *)&header,sizeof(header));
+      for (uint64_t begin=0;begin<count;begin+=lorenzoBlockSize) {
+        const uint64_t end = std::min(count,begin+lorenzoBlockSize);
+        uint32_t maxCode = 0;
+        for (uint64_t j=begin;j<end;j++)
+          maxCode = std::max(maxCode,codes[j]);
+        int width = 0;
+        while (width < 32 && (maxCode >> width)) width++;
+        out.push_back(char(width));
+        uint64_t bits = 0;
+        int numBits = 0;
+        for (uint64_t j=begin;j<end;j++) {
+          bits |= uint64_t(codes[j]) << numBits;
+          numBits += width;
+          for (;numBits >= 8;numBits -= 8, bits >>= 8)
+            out.push_back(char(bits & 0xff));
+        }
+        if (numBits > 0) out.push_back(char(bits & 0xff));
+      }
+      out.append((const char *)outliers.data(),outliers.size()*sizeof(float));
+      return out;
+    }
+
+    static void decodeLorenzo(const uint8_t *data, uint64_t size,
+                              float *scalars, uint64_t count)
+    {
+      const uint8_t *end = data + size;
+      LorenzoHeader header;
+      if (size < sizeof(header))
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+      memcpy(&header,data,sizeof(header));
+      data += sizeof(header);
+      const vec3i dims(header.dims[0],header.dims[1],header.dims[2]);
+      if (dims.x < 0 || dims.y < 0 || dims.z < 0 ||
+          uint64_t(dims.x)*dims.y*dims.z != count)
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+
+      std::vector<uint32_t> codes(count);
+      for (uint64_t begin=0;begin<count;begin+=lorenzoBlockSize) {
+        const uint64_t blockEnd = std::min(count,begin+lorenzoBlockSize);
+        if (data >= end)
+          throw std::runtime_error("tamr: corrupt compressed chunk");
+        const int width = *data++;
+        if (width > 32 || uint64_t(end-data) < ((blockEnd-begin)*width+7)/8)
+          throw std::runtime_error("tamr: corrupt compressed chunk");
+        const uint64_t mask = (1ull<<width)-1;
+        uint64_t bits = 0;
+        int numBits = 0;
+        for (uint64_t j=begin;j<blockEnd;j++) {
+          for (;numBits < width;numBits += 8)
+            bits |= uint64_t(*data++) << numBits;
+          codes[j] = uint32_t(bits & mask);
+          bits >>= width;
+          numBits -= width;
+        }
+      }
+      if (uint64_t(end-data) != header.numOutliers*sizeof(float))
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+
+      const double quantum = 2.*header.errorBound;
+      const uint8_t *outlier = data;
+      uint64_t i = 0;
+      for (int z=0;z<dims.z;z++)
+        for (int y=0;y<dims.y;y++)
+          for (int x=0;x<dims.x;x++,i++) {
+            if (codes[i] == 0) {
+              if (outlier >= end)
+                throw std::runtime_error("tamr: corrupt compressed chunk");
+              memcpy(scalars+i,outlier,sizeof(float));
+              outlier += sizeof(float);
+            } else {
+              const double pred = lorenzo(scalars,dims,x,y,z);
+              scalars[i] = float(pred + unzigzag(codes[i]-1)*quantum);
+            }
+          }
+    }
+
+    /*! a CHUNK_QUANTIZED chunk is this, followed by the quantized
+        values */
+    struct QuantizedHeader {
+      uint32_t format;
+      QuantizedField::GridRange range;
+    };
+
+    static std::string encodeQuantized(const float *scalars, uint64_t count,
+                                       QuantizedField::Format format)
+    {
+      QuantizedHeader header;
+      header.format = format;
+      header.range  = { 0.f, 0.f };
+      std::string out(1+sizeof(header)+count*QuantizedField::bytesPerScalar(format),0);
+      out[0] = char(CHUNK_QUANTIZED);
+      QuantizedField::quantize(format,scalars,count,&out[1+sizeof(header)],header.range);
+      memcpy(&out[1],&header,sizeof(header));
+      return out;
+    }
+
+    static void decodeQuantized(const uint8_t *data, uint64_t size,
+                                float *scalars, uint64_t count)
+    {
+      QuantizedHeader header;
+      if (size < sizeof(header))
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+      memcpy(&header,data,sizeof(header));
+      if (header.format > QuantizedField::FORMAT_UNORM16)
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+      const QuantizedField::Format format = (QuantizedField::Format)header.format;
+      if (size-sizeof(header) != count*QuantizedField::bytesPerScalar(format))
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+      QuantizedField::dequantize(format,data+sizeof(header),count,scalars,header.range);
+    }
+
+    /*! encodes one chunk, falling back to storing it raw if it doesn't compress */
+    static std::string encodeChunk(const float *scalars, uint64_t count)
+    {
+      std::vector<uint8_t> planes(count*sizeof(float));
+      shuffle(scalars,count,planes.data());
+      std::string out(1,char(CHUNK_SHUFFLED_LZ));
+      compressLZ(planes.data(),planes.size(),out);
+      if (out.size() >= 1+count*sizeof(float)) {
+        out.assign(1,char(CHUNK_RAW));
+        out.append((const char *)scalars,count*sizeof(float));
+      }
+      return out;
+    }
+
+    void decodeChunk(const uint8_t *data, uint64_t size,
+                     float *scalars, uint64_t count)
+    {
+      if (size < 1)
+        throw std::runtime_error("tamr: corrupt compressed chunk");
+      switch (data[0]) {
+      case CHUNK_RAW:
+        if (size-1 != count*sizeof(float))
+          throw std::runtime_error("tamr: corrupt compressed chunk");
+        memcpy(scalars,data+1,count*sizeof(float));
+        break;
+      case CHUNK_SHUFFLED_LZ: {
+        std::vector<uint8_t> planes(count*sizeof(float));
+        decompressLZ(data+1,size-1,planes.data(),planes.size());
+        unshuffle(planes.data(),count,scalars);
+      } break;
+      case CHUNK_LORENZO:
+        decodeLorenzo(data+1,size-1,scalars,count);
+        break;
+      case CHUNK_QUANTIZED:
+        decodeQuantized(data+1,size-1,scalars,count);
+        break;
+      default:
+        throw std::runtime_error("tamr: unknown chunk mode");
+      }
+    }
+
+    /*! one chunk to be encoded */
+    struct ChunkSpec {
+      uint64_t begin;
+      uint64_t count;
+      /*! shape of the chunk's scalars, for CHUNK_LORENZO */
+      vec3i    dims;
+      /*! if > 0, encode as CHUNK_LORENZO with this bound */
+      float    errorBound;
+      /*! if >= 0, encode as CHUNK_QUANTIZED with this
+          QuantizedField::Format instead */
+      int      quantization = -1;
+    };
+
+    /*! encodes the given chunks (which must tile [0,numScalars), in
+        order) in parallel, and assembles them into a payload of
+        given encoding */
+    static std::string encodeChunks(uint32_t encoding,
+                                    uint64_t numScalars,
+                                    const std::vector<ChunkSpec> &specs,
+                                    const ScalarSource &getScalars,
+                                    int numThreads)
+    {
+      std::vector<std::string> chunks(specs.size());
+      parallel_for(specs.size(),[&](size_t chunkID){
+        const ChunkSpec &spec = specs[chunkID];
+        std::vector<float> scalars(spec.count);
+        getScalars(spec.begin,spec.count,scalars.data());
+        chunks[chunkID]
+          = spec.quantization >= 0
+          ? encodeQuantized(scalars.data(),spec.count,
+                            (QuantizedField::Format)spec.quantization)
+          : spec.errorBound > 0.f
+          ? encodeLorenzo(scalars.data(),spec.dims,spec.errorBound)
+          : encodeChunk(scalars.data(),spec.count);
+      },numThreads);
+
+      std::string tables;
+      if (encoding == ENCODING_LOSSLESS) {
+        LosslessHeader header;
+        header.numScalars      = numScalars;
+        header.scalarsPerChunk = losslessChunkSize;
+        tables.append((const char *)&header,sizeof(header));
+      } else {
+        LossyHeader header;
+        header.numScalars = numScalars;
+        header.numChunks  = specs.size();
+        tables.append((const char *)&header,sizeof(header));
+        for (auto &spec : specs)
+          tables.append((const char *)&spec.begin,sizeof(spec.begin));
+        tables.append((const char *)&numScalars,sizeof(numScalars));
+      }
+      std::vector<uint64_t> byteBegin(chunks.size()+1);
+      byteBegin[0] = tables.size() + byteBegin.size()*sizeof(uint64_t);
+      for (size_t i=0;i<chunks.size();i++)
+        byteBegin[i+1] = byteBegin[i] + chunks[i].size();
+
+      std::string payload;
+      payload.reserve(byteBegin.back());
+      payload.append(tables);
+      payload.append((const char *)byteBegin.data(),byteBegin.size()*sizeof(uint64_t));
+      for (auto &chunk : chunks)
+        payload.append(chunk);
+      return payload;
+    }
+
+    /*! appends lossless chunks covering [begin,end) */
+    static void addLosslessChunks(std::vector<ChunkSpec> &specs,
+                                  uint64_t begin, uint64_t end)
+    {
+      for (;begin<end;begin+=losslessChunkSize) {
+        const uint64_t count = std::min(losslessChunkSize,end-begin);
+        specs.push_back({begin,count,vec3i(int(count),1,1),0.f});
+      }
+    }
+
+    /*! makes a ScalarSource out of the pieces of a pending scalars
+        section; anything not covered by those pieces (padding
+        between fields) is zero */
+    static ScalarSource sourceOf(const PendingSection &scalars)
+    {
+      if (scalars.section.encoding != ENCODING_RAW || !scalars.bytes.empty())
+        throw std::runtime_error("tamr: can only compress raw scalars");
+      return [&scalars](uint64_t begin, uint64_t count, float *dst) {
+        memset(dst,0,count*sizeof(float));
+        const uint64_t end = begin+count;
+        for (auto &piece : scalars.pieces) {
+          const uint64_t pieceBegin = piece.offset/sizeof(float);
+          const uint64_t pieceEnd   = pieceBegin + piece.size/sizeof(float);
+          const uint64_t lo = std::max(begin,pieceBegin);
+          const uint64_t hi = std::min(end,pieceEnd);
+          if (lo < hi)
+            memcpy(dst+(lo-begin),(const float *)piece.data+(lo-pieceBegin),
+                   (hi-lo)*sizeof(float));
+        }
+      };
+    }
+
+    void compressScalars(PendingSection &scalars, int numThreads)
+    {
+      ScalarSource getScalars = sourceOf(scalars);
+      std::vector<ChunkSpec> specs;
+      addLosslessChunks(specs,0,scalars.section.count);
+      scalars.bytes = encodeChunks(ENCODING_LOSSLESS,scalars.section.count,
+                                   specs,getScalars,numThreads);
+      scalars.pieces.clear();
+      scalars.section.encoding = ENCODING_LOSSLESS;
+      scalars.section.size     = scalars.bytes.size();
+    }
+
+    std::string encodeLossless(const float *scalars, uint64_t count, int numThreads)
+    {
+      std::vector<ChunkSpec> specs;
+      addLosslessChunks(specs,0,count);
+      return encodeChunks(ENCODING_LOSSLESS,count,specs,
+                          [scalars](uint64_t begin, uint64_t n, float *dst)
+                          { memcpy(dst,scalars+begin,n*sizeof(float)); },
+                          numThreads);
+    }
+
+    /*! bitwise XOR of two arrays of floats */
+    static void xorScalars(const float *a, const float *b, float *result, uint64_t count)
+    {
+      for (uint64_t i=0;i<count;i++) {
+        uint32_t bitsA, bitsB;
+        memcpy(&bitsA,a+i,4);
+        memcpy(&bitsB,b+i,4);
+        const uint32_t bits = bitsA ^ bitsB;
+        memcpy(result+i,&bits,4);
+      }
+    }
+
+    std::string encodeTemporalDelta(const float *scalars, const float *previous,
+                                    uint64_t count, int numThreads)
+    {
+      std::vector<ChunkSpec> specs;
+      addLosslessChunks(specs,0,count);
+      return encodeChunks(ENCODING_LOSSLESS,count,specs,
+                          [&](uint64_t begin, uint64_t n, float *dst)
+                          { xorScalars(scalars+begin,previous+begin,dst,n); },
+                          numThreads);
+    }
+
+    void compressScalarsLossy(FilePlan &plan, const Model &model,
+                              const IOOptions &options)
+    {
+      PendingSection *scalars = nullptr;
+      for (auto &pending : plan.sections)
+        if (pending.section.type == SECTION_SCALARS)
+          scalars = &pending;
+      if (!scalars)
+        throw std::runtime_error("tamr: plan has no scalars section");
+      ScalarSource getScalars = sourceOf(*scalars);
+      const uint64_t numCells = model.numCellsAcrossAllGrids;
+
+      std::vector<ChunkSpec> specs;
+      for (auto &pending : plan.sections) {
+        const Section &field = pending.section;
+        if (field.type != SECTION_FIELD_SCALARS) continue;
+        const Model::FieldMeta &meta = model.fieldMetas[field.index];
+        auto addGridChunks = [&](float errorBound, int quantization) {
+          for (int dim=0;dim<meta.numDimensions;dim++)
+            for (auto &grid : model.grids) {
+              const uint64_t begin = dim*numCells + grid.offset;
+              const uint64_t count = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+              if (count == 0 || begin+count > field.count) continue;
+              specs.push_back({field.begin+begin,count,grid.dims,errorBound,quantization});
+            }
+        };
+        auto quantized = options.quantizedFields.find(meta.name);
+        if (quantized != options.quantizedFields.end()) {
+          addGridChunks(0.f,quantized->second);
+          continue;
+        }
+        auto it = options.errorBounds.find(meta.name);
+        if (it == options.errorBounds.end() || it->second.value <= 0.f) continue;
+
+        float errorBound = it->second.value;
+        if (it->second.relative) {
+          float lo = INFINITY, hi = -INFINITY;
+          const float *v = model.scalars.data()+meta.offset;
+          for (uint64_t i=0;i<field.count;i++)
+            if (std::isfinite(v[i])) { lo = std::min(lo,v[i]); hi = std::max(hi,v[i]); }
+          errorBound *= lo <= hi ? hi-lo : 0.f;
+          if (errorBound <= 0.f) continue;
+        }
+        addGridChunks(errorBound,-1);
+      }
+      std::sort(specs.begin(),specs.end(),[](const ChunkSpec &a, const ChunkSpec &b)
+      { return a.begin < b.begin; });
+
+      // fill all gaps with lossless chunks
+      std::vector<ChunkSpec> tiled;
+      uint64_t end = 0;
+      for (auto &spec : specs) {
+        if (spec.begin < end)
+          throw std::runtime_error("tamr: lossy compression requires grids "
+                                   "whose scalars do not overlap");
+        addLosslessChunks(tiled,end,spec.begin);
+        tiled.push_back(spec);
+        end = spec.begin+spec.count;
+      }
+      addLosslessChunks(tiled,end,scalars->section.count);
+
+      scalars->bytes = encodeChunks(ENCODING_LOSSY,scalars->section.count,
+                                    tiled,getScalars,options.numThreads);
+      scalars->pieces.clear();
+      scalars->section.encoding = ENCODING_LOSSY;
+      scalars->section.size     = scalars->bytes.size();
+    }
+
+    ChunkTable readChunkTable(const Section &section, const ByteSource &readBytes)
+    {
+      ChunkTable table;
+      uint64_t numChunks = 0;
+      uint64_t tableBegin = 0;
+      if (section.encoding == ENCODING_LOSSLESS ||
+          section.encoding == ENCODING_TEMPORAL_DELTA) {
+        LosslessHeader header;
+        readBytes(0,sizeof(header),&header);
+        if (header.numScalars != section.count || header.scalarsPerChunk == 0)
+          throw std::runtime_error("tamr: corrupt compressed section");
+        numChunks = (section.count+header.scalarsPerChunk-1)/header.scalarsPerChunk;
+        table.scalarBegin.resize(numChunks+1);
+        for (uint64_t i=0;i<=numChunks;i++)
+          table.scalarBegin[i] = std::min(i*header.scalarsPerChunk,section.count);
+        tableBegin = sizeof(header);
+      } else if (section.encoding == ENCODING_LOSSY) {
+        LossyHeader header;
+        readBytes(0,sizeof(header),&header);
+        if (header.numScalars != section.count ||
+            (header.numChunks+1)*2*sizeof(uint64_t) > section.size)
+          throw std::runtime_error("tamr: corrupt compressed section");
+        numChunks = header.numChunks;
+        table.scalarBegin.resize(numChunks+1);
+        readBytes(sizeof(header),table.scalarBegin.size()*sizeof(uint64_t),
+                  table.scalarBegin.data());
+        tableBegin = sizeof(header) + table.scalarBegin.size()*sizeof(uint64_t);
+      } else
+        throw std::runtime_error("tamr: unsupported section encoding");
+
+      if ((numChunks+1)*sizeof(uint64_t) > section.size)
+        throw std::runtime_error("tamr: corrupt compressed section");
+      table.byteBegin.resize(numChunks+1);
+      readBytes(tableBegin,table.byteBegin.size()*sizeof(uint64_t),
+                table.byteBegin.data());
+      for (uint64_t i=0;i<numChunks;i++)
+        if (table.scalarBegin[i] > table.scalarBegin[i+1] ||
+            table.byteBegin[i] > table.byteBegin[i+1])
+          throw std::runtime_error("tamr: corrupt compressed section");
+      if (table.scalarBegin.front() != 0 ||
+          table.scalarBegin.back() != section.count ||
+          table.byteBegin.back() > section.size)
+        throw std::runtime_error("tamr: corrupt compressed section");
+      return table;
+    }
+
+    void decodeScalars(const Section &section, const uint8_t *payload,
+                       float *scalars, int numThreads)
+    {
+      if (section.encoding == ENCODING_TEMPORAL_DELTA)
+        throw std::runtime_error("tamr: temporal delta scalars can only be "
+                                 "read through a TimeSeries");
+      ChunkTable table
+        = readChunkTable(section,[&](uint64_t offset, uint64_t size, void *dst) {
+          if (offset+size > section.size)
+            throw std::runtime_error("tamr: corrupt compressed section");
+          memcpy(dst,payload+offset,size);
+        });
+      parallel_for(table.numChunks(),[&](size_t chunkID){
+        decodeChunk(payload+table.byteBegin[chunkID],
+                    table.byteBegin[chunkID+1]-table.byteBegin[chunkID],
+                    scalars+table.scalarBegin[chunkID],
+                    table.scalarBegin[chunkID+1]-table.scalarBegin[chunkID]);
+      },numThreads);
+    }
+
+    void decodeTemporalDelta(const Section &section, const uint8_t *payload,
+                             const float *previous, float *scalars,
+                             int numThreads)
+    {
+      if (section.encoding != ENCODING_TEMPORAL_DELTA)
+        throw std::runtime_error("tamr: not a temporal delta section");
+      ChunkTable table
+        = readChunkTable(section,[&](uint64_t offset, uint64_t size, void *dst) {
+          if (offset+size > section.size)
+            throw std::runtime_error("tamr: corrupt compressed section");
+          memcpy(dst,payload+offset,size);
+        });
+      parallel_for(table.numChunks(),[&](size_t chunkID){
+        const uint64_t begin = table.scalarBegin[chunkID];
+        const uint64_t count = table.scalarBegin[chunkID+1]-begin;
+        decodeChunk(payload+table.byteBegin[chunkID],
+                    table.byteBegin[chunkID+1]-table.byteBegin[chunkID],
+                    scalars+begin,count);
+        xorScalars(scalars+begin,previous+begin,scalars+begin,count);
+      },numThreads);
+    }
+
+  } // ::tamr::format
+} // ::tamr
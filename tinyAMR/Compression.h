@@ -0,0 +1,128 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! \file Compression.h codecs for the scalars section of .tamr files.
+
+    Encoded scalars sections are sequences of independently encoded
+    chunks of consecutive scalars, so chunks can be decoded in
+    parallel, and any range of scalars can be decoded without
+    touching the rest. An ENCODING_LOSSLESS payload uses chunks of a
+    fixed number of scalars:
+
+      LosslessHeader
+      uint64_t byteBegin[numChunks+1]    // relative to payload start
+      chunk data
+
+    An ENCODING_LOSSY payload uses chunks of any size - typically one
+    per grid, and field dimension - so it also stores where each one
+    begins:
+
+      LossyHeader
+      uint64_t scalarBegin[numChunks+1]
+      uint64_t byteBegin[numChunks+1]
+      chunk data
+
+    Each chunk starts with one byte that says how it is stored:
+    CHUNK_RAW is just the floats; CHUNK_SHUFFLED_LZ XORs each float's
+    bits with those of the previous float, splits the result into
+    four byte planes, and compresses those with a simple LZ77 variant;
+    CHUNK_LORENZO treats the chunk as a 3D grid of scalars, predicts
+    each scalar from its already decoded neighbors, and stores the
+    prediction errors quantized such that no scalar ever deviates
+    from its original value by more than a given error bound (see
+    Compression.cpp); CHUNK_QUANTIZED stores the chunk's scalars in
+    one of QuantizedField's reduced-precision formats, and gets
+    dequantized when read. */
+
+#pragma once
+
+#include "tinyAMR/FileFormat.h"
+#include <functional>
+
+namespace tamr {
+  namespace format {
+
+    /*! number of scalars per chunk that the encoder uses for
+        lossless chunks */
+    const uint64_t losslessChunkSize = 1ull<<16;
+
+    struct LosslessHeader {
+      uint64_t numScalars;
+      uint64_t scalarsPerChunk;
+    };
+
+    struct LossyHeader {
+      uint64_t numScalars;
+      uint64_t numChunks;
+    };
+
+    typedef enum : uint8_t {
+      CHUNK_RAW = 0,
+      CHUNK_SHUFFLED_LZ,
+      CHUNK_LORENZO,
+      CHUNK_QUANTIZED,
+    } ChunkMode;
+
+    /*! provides scalars [begin,begin+count) to the encoder */
+    typedef std::function<void(uint64_t begin, uint64_t count, float *dst)> ScalarSource;
+
+    /*! reads 'size' bytes at given offset of a section's payload */
+    typedef std::function<void(uint64_t offset, uint64_t size, void *dst)> ByteSource;
+
+    /*! replaces the (raw) payload of given pending SCALARS section
+        with its ENCODING_LOSSLESS encoding */
+    void compressScalars(PendingSection &scalars, int numThreads = 0);
+
+    /*! replaces the (raw) payload of the given plan's SCALARS section
+        (which must be the plan of given model) with its
+        ENCODING_LOSSY encoding: every grid's scalars of each field
+        that has an entry in options.quantizedFields become one
+        CHUNK_QUANTIZED chunk of that format, those of each other
+        field that has an entry in options.errorBounds one
+        CHUNK_LORENZO chunk with that error bound; everything else
+        gets stored lossless */
+    void compressScalarsLossy(FilePlan &plan, const Model &model,
+                              const IOOptions &options);
+
+    /*! ENCODING_LOSSLESS payload for given scalars */
+    std::string encodeLossless(const float *scalars, uint64_t count,
+                               int numThreads = 0);
+
+    /*! ENCODING_TEMPORAL_DELTA payload for given scalars, relative
+        to the (same number of) scalars of the previous timestep */
+    std::string encodeTemporalDelta(const float *scalars, const float *previous,
+                                    uint64_t count, int numThreads = 0);
+
+    /*! reads the chunk table of an encoded SCALARS section */
+    ChunkTable readChunkTable(const Section &section, const ByteSource &readBytes);
+
+    /*! decodes one chunk of 'count' scalars */
+    void decodeChunk(const uint8_t *data, uint64_t size,
+                     float *scalars, uint64_t count);
+
+    /*! decodes the entire (in-memory) payload of an encoded SCALARS
+        section into 'scalars', decoding chunks in parallel */
+    void decodeScalars(const Section &section, const uint8_t *payload,
+                       float *scalars, int numThreads = 0);
+
+    /*! decodes an ENCODING_TEMPORAL_DELTA payload, given the
+        previous timestep's scalars */
+    void decodeTemporalDelta(const Section &section, const uint8_t *payload,
+                             const float *previous, float *scalars,
+                             int numThreads = 0);
+
+  } // ::tamr::format
+} // ::tamr
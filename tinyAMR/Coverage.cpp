@@ -0,0 +1,200 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/Coverage.h"
+#include "tinyAMR/parallel_for.h"
+
+namespace tamr {
+
+  Coverage::SP Coverage::compute(const Model &model, int numThreads)
+  {
+    const GridIndex index(model,numThreads);
+    return compute(index,numThreads);
+  }
+
+  Coverage::SP Coverage::compute(const GridIndex &index, int numThreads)
+  {
+    const Model &model = index.model;
+    const size_t numGrids = model.grids.size();
+    Coverage::SP result = std::make_shared<Coverage>(model);
+
+    // each grid's bits start at a new word, so grids can be
+    // processed in parallel
+    result->maskBegin.resize(numGrids+1);
+    result->maskBegin[0] = 0;
+    for (size_t gridID=0;gridID<numGrids;gridID++) {
+      const vec3i dims = model.grids[gridID].dims;
+      const uint64_t numCells = uint64_t(dims.x)*dims.y*dims.z;
+      result->maskBegin[gridID+1] = result->maskBegin[gridID]+(numCells+63)/64;
+    }
+    result->masks.assign(result->maskBegin[numGrids],0);
+    result->numActiveCells.resize(numGrids);
+
+    parallel_for(numGrids,[&](size_t gridID) {
+      const Model::Grid &grid = model.grids[gridID];
+      const float width = model.cellWidth(grid.level);
+      uint64_t *mask = result->masks.data()+result->maskBegin[gridID];
+      index.forEachOverlapping(model.worldBounds(grid),[&](size_t otherID) {
+        const Model::Grid &other = model.grids[otherID];
+        if (model.cellWidth(other.level) >= width) return;
+        // range of our cells whose centers are in [lower,upper) of
+        // the finer grid
+        const box3f covered = model.logicalBounds(other);
+        const vec3f lo = covered.lower/width-vec3f(grid.origin)-vec3f(.5f);
+        const vec3f hi = covered.upper/width-vec3f(grid.origin)-vec3f(.5f);
+        const vec3i begin = max(vec3i(0),vec3i(int(ceilf(lo.x)),int(ceilf(lo.y)),int(ceilf(lo.z))));
+        const vec3i end   = min(grid.dims,vec3i(int(ceilf(hi.x)),int(ceilf(hi.y)),int(ceilf(hi.z))));
+        for (int iz=begin.z;iz<end.z;iz++)
+          for (int iy=begin.y;iy<end.y;iy++)
+            for (int ix=begin.x;ix<end.x;ix++) {
+              const uint64_t cellIndex = model.cellIndex(grid,vec3i(ix,iy,iz));
+              mask[cellIndex >> 6] |= 1ull << (cellIndex & 63);
+            }
+      });
+      const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+      uint64_t numCovered = 0;
+      for (uint64_t i=0;i<(numCells+63)/64;i++)
+        numCovered += __builtin_popcountll(mask[i]);
+      result->numActiveCells[gridID] = numCells-numCovered;
+    },numThreads);
+
+    for (auto count : result->numActiveCells)
+      result->totalActiveCells += count;
+    return result;
+  }
+
+  Model::SP Coverage::compact(Compaction mode, int numThreads) const
+  {
+    const size_t numGrids = model.grids.size();
+
+    // the boxes of cells (relative to the grid's origin, with
+    // exclusive upper bounds) that each grid gets split into
+    struct Piece {
+      size_t gridID;
+      vec3i  begin, end;
+    };
+    std::vector<std::vector<Piece>> piecesOf(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      const Model::Grid &grid = model.grids[gridID];
+      const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+      if (numActiveCells[gridID] == 0) return;
+      if (mode == COMPACT_DROP_COVERED_GRIDS || numActiveCells[gridID] == numCells) {
+        piecesOf[gridID].push_back({gridID,vec3i(0),grid.dims});
+        return;
+      }
+      // greedily grow boxes of active cells, first along x, then y,
+      // then z
+      std::vector<uint8_t> taken(numCells,0);
+      auto isFree = [&](int ix, int iy, int iz) {
+        return !taken[linearCellIndex(grid.dims,vec3i(ix,iy,iz))]
+          && !isCovered(gridID,vec3i(ix,iy,iz));
+      };
+      for (int iz=0;iz<grid.dims.z;iz++)
+        for (int iy=0;iy<grid.dims.y;iy++)
+          for (int ix=0;ix<grid.dims.x;ix++) {
+            if (!isFree(ix,iy,iz)) continue;
+            vec3i end(ix+1,iy+1,iz+1);
+            while (end.x < grid.dims.x && isFree(end.x,iy,iz))
+              end.x++;
+            auto rowIsFree = [&](int y, int z) {
+              for (int x=ix;x<end.x;x++)
+                if (!isFree(x,y,z)) return false;
+              return true;
+            };
+            while (end.y < grid.dims.y && rowIsFree(end.y,iz))
+              end.y++;
+            auto slabIsFree = [&](int z) {
+              for (int y=iy;y<end.y;y++)
+                if (!rowIsFree(y,z)) return false;
+              return true;
+            };
+            while (end.z < grid.dims.z && slabIsFree(end.z))
+              end.z++;
+            for (int z=iz;z<end.z;z++)
+              for (int y=iy;y<end.y;y++)
+                for (int x=ix;x<end.x;x++)
+                  taken[linearCellIndex(grid.dims,vec3i(x,y,z))] = 1;
+            piecesOf[gridID].push_back({gridID,vec3i(ix,iy,iz),end});
+          }
+    },numThreads);
+
+    Model::SP result = std::make_shared<Model>();
+    result->refinementOfLevel = model.refinementOfLevel;
+    result->userMeta          = model.userMeta;
+    result->gridOrigin        = model.gridOrigin;
+    result->gridOffset        = model.gridOffset;
+    result->cellLayout        = model.cellLayout;
+
+    std::vector<Piece> pieces;
+    std::vector<Model::Grid> grids;
+    uint64_t numCells = 0;
+    for (auto &gridPieces : piecesOf)
+      for (auto &piece : gridPieces) {
+        Model::Grid grid = model.grids[piece.gridID];
+        grid.origin = grid.origin+piece.begin;
+        grid.dims   = piece.end-piece.begin;
+        grid.offset = numCells;
+        numCells += uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+        grids.push_back(grid);
+        pieces.push_back(piece);
+      }
+    result->numCellsAcrossAllGrids = numCells;
+
+    // where each dimension of each field starts, in the old and the
+    // new scalars
+    std::vector<std::pair<uint64_t,uint64_t>> streams;
+    uint64_t numScalars = 0;
+    for (auto meta : model.fieldMetas) {
+      for (int dim=0;dim<meta.numDimensions;dim++)
+        streams.push_back({meta.offset+dim*model.numCellsAcrossAllGrids,
+                           numScalars+dim*numCells});
+      meta.offset = numScalars;
+      numScalars += meta.numDimensions*numCells;
+      result->fieldMetas.push_back(meta);
+    }
+
+    std::vector<float> scalars(numScalars);
+    parallel_for(grids.size(),[&](size_t newGridID) {
+      const Piece &piece = pieces[newGridID];
+      const Model::Grid &oldGrid = model.grids[piece.gridID];
+      const Model::Grid &newGrid = grids[newGridID];
+      const uint64_t count = uint64_t(newGrid.dims.x)*newGrid.dims.y*newGrid.dims.z;
+      for (auto &stream : streams) {
+        const float *in  = model.scalars.data()+stream.first+oldGrid.offset;
+        float       *out = scalars.data()+stream.second+newGrid.offset;
+        if (stream.first+oldGrid.offset+uint64_t(oldGrid.dims.x)*oldGrid.dims.y*oldGrid.dims.z
+            > model.scalars.size())
+          throw std::runtime_error("tamr::Coverage: grid exceeds the model's scalars");
+        if (newGrid.dims == oldGrid.dims) {
+          std::copy(in,in+count,out);
+          continue;
+        }
+        for (int iz=0;iz<newGrid.dims.z;iz++)
+          for (int iy=0;iy<newGrid.dims.y;iy++)
+            for (int ix=0;ix<newGrid.dims.x;ix++) {
+              const vec3i cell(ix,iy,iz);
+              out[model.cellIndex(newGrid,cell)]
+                = in[model.cellIndex(oldGrid,piece.begin+cell)];
+            }
+      }
+    },numThreads);
+
+    result->grids   = Array<Model::Grid>(std::move(grids));
+    result->scalars = Array<float>(std::move(scalars));
+    return result;
+  }
+
+} // ::tamr
@@ -0,0 +1,77 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/GridIndex.h"
+
+namespace tamr {
+
+  /*! which of a model's cells are covered by finer grids - ie, whose
+      center is inside a grid with smaller cells - with one bit per
+      cell, per grid. All other cells are 'active' (or 'leaf') cells;
+      these are the ones that reductions over a model - histograms,
+      averages, etc - should look at. Importers that keep parent
+      blocks (eg, FLASH) produce many covered cells, and even grids
+      that are covered entirely; compact() returns a model without
+      those. Like GridIndex, this refers to the model it was computed
+      for. */
+  struct Coverage {
+    typedef std::shared_ptr<Coverage> SP;
+
+    typedef enum {
+      /*! drops grids all of whose cells are covered; all other grids
+          stay as they are, covered cells and all */
+      COMPACT_DROP_COVERED_GRIDS,
+      /*! also splits each partially covered grid into boxes of its
+          active cells, so only active cells remain */
+      COMPACT_ACTIVE_CELLS_ONLY,
+    } Compaction;
+
+    /*! computes coverage of the index's model, with the grids
+        getting processed in parallel */
+    static SP compute(const GridIndex &index, int numThreads = 0);
+    /*! same, but builds a GridIndex for that first */
+    static SP compute(const Model &model, int numThreads = 0);
+
+    Coverage(const Model &model) : model(model) {}
+
+    /*! whether the cell with given index among the grid's scalars
+        (ie, relative to grid.offset) is covered */
+    bool isCovered(size_t gridID, uint64_t cellIndex) const
+    { return (masks[maskBegin[gridID]+(cellIndex >> 6)] >> (cellIndex & 63)) & 1; }
+
+    /*! whether given cell (relative to the grid's origin) is covered */
+    bool isCovered(size_t gridID, const vec3i &cell) const
+    { return isCovered(gridID,model.cellIndex(model.grids[gridID],cell)); }
+
+    /*! returns a copy of the model without covered cells, or without
+        covered grids, depending on 'mode'; all fields get copied,
+        and the scalars of different grids never get shared */
+    Model::SP compact(Compaction mode, int numThreads = 0) const;
+
+    const Model &model;
+    /*! the bits of grid 'i' are masks[maskBegin[i]..maskBegin[i+1]),
+        in the same order as the grid's scalars; 1 means covered */
+    std::vector<uint64_t> maskBegin;
+    std::vector<uint64_t> masks;
+    /*! number of active cells in each grid */
+    std::vector<uint64_t> numActiveCells;
+    /*! number of active cells across all grids */
+    uint64_t              totalActiveCells = 0;
+  };
+
+} // ::tamr
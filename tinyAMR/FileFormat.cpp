@@ -0,0 +1,482 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/FileFormat.h"
+#include "tinyAMR/Compression.h"
+#include "tinyAMR/parallel_for.h"
+#include <algorithm>
+#include <cstring>
+
+namespace tamr {
+  namespace format {
+
+    static_assert(sizeof(Header) == 64, "Header must be 64 bytes");
+    static_assert(sizeof(Section) == 48, "Section must be 48 bytes");
+
+    const Section *Layout::find(uint32_t type, uint32_t index) const
+    {
+      for (auto &section : sections)
+        if (section.type == type && section.index == index)
+          return &section;
+      return nullptr;
+    }
+
+    const Section &Layout::get(uint32_t type, uint32_t index) const
+    {
+      const Section *section = find(type,index);
+      if (!section)
+        throw std::runtime_error("tamr: file is missing section #"
+                                 +std::to_string(type));
+      return *section;
+    }
+
+    uint64_t numScalarsOf(const Model::FieldMeta &meta,
+                          uint64_t numCellsAcrossAllGrids,
+                          uint64_t numScalars)
+    {
+      if (meta.offset >= numScalars) return 0;
+      return std::min(uint64_t(meta.numDimensions)*numCellsAcrossAllGrids,
+                      numScalars-meta.offset);
+    }
+
+    std::string serializeFieldMetas(const std::vector<Model::FieldMeta> &metas)
+    {
+      std::stringstream out;
+      write(out,(int)metas.size());
+      for (auto &meta : metas) {
+        writeString(out,meta.name);
+        write(out,meta.numDimensions);
+        write(out,meta.offset);
+        writeString(out,meta.info);
+      }
+      return out.str();
+    }
+
+    std::vector<Model::FieldMeta> readFieldMetas(std::istream &in)
+    {
+      std::vector<Model::FieldMeta> metas(read<int>(in));
+      for (auto &meta : metas) {
+        meta.name = readString(in);
+        meta.numDimensions = read<int>(in);
+        meta.offset = read<uint64_t>(in);
+        meta.info = readString(in);
+      }
+      return metas;
+    }
+
+    /*! adds one FIELD_SCALARS section per field, for the given field
+        metas and a scalars section at given offset */
+    static void addFieldScalarSections(std::vector<Section> &sections,
+                                       const std::vector<Model::FieldMeta> &metas,
+                                       const Section &scalars,
+                                       uint64_t numCellsAcrossAllGrids)
+    {
+      for (size_t fieldID=0;fieldID<metas.size();fieldID++) {
+        Section section = {};
+        section.type   = SECTION_FIELD_SCALARS;
+        section.index  = (uint32_t)fieldID;
+        section.begin  = metas[fieldID].offset;
+        section.count  = numScalarsOf(metas[fieldID],numCellsAcrossAllGrids,scalars.count);
+        section.offset = scalars.offset + section.begin*sizeof(float);
+        section.size   = section.count*sizeof(float);
+        sections.push_back(section);
+      }
+    }
+
+    /*! reconstructs the layout of a v1 file by reading its small
+        arrays and skipping over the big ones */
+    static Layout readLayout_v1(std::istream &in)
+    {
+      Layout layout;
+      layout.version = 1;
+      layout.header  = {};
+      layout.header.magic   = magic_v1;
+      layout.header.version = 1;
+
+      auto skipArray = [&](uint32_t type, size_t elementSize) {
+        Section section = {};
+        section.type   = type;
+        section.count  = read<size_t>(in);
+        section.offset = in.tellg();
+        section.size   = section.count*elementSize;
+        in.seekg(section.size,std::ios::cur);
+        layout.sections.push_back(section);
+        return section;
+      };
+      skipArray(SECTION_REFINEMENT_OF_LEVEL,sizeof(int));
+      Section scalars = skipArray(SECTION_SCALARS,sizeof(float));
+      skipArray(SECTION_GRIDS,sizeof(Model::Grid));
+      layout.header.numCellsAcrossAllGrids = read<size_t>(in);
+
+      Section metas = {};
+      metas.type   = SECTION_FIELD_METAS;
+      metas.offset = in.tellg();
+      std::vector<Model::FieldMeta> fieldMetas = readFieldMetas(in);
+      metas.count  = fieldMetas.size();
+      metas.size   = uint64_t(in.tellg()) - metas.offset;
+      layout.sections.push_back(metas);
+
+      Section userMeta = {};
+      userMeta.type   = SECTION_USER_META;
+      userMeta.count  = userMeta.size = read<int>(in);
+      userMeta.offset = in.tellg();
+      in.seekg(userMeta.size,std::ios::cur);
+      layout.sections.push_back(userMeta);
+
+      layout.header.gridOrigin = read<vec3f>(in);
+      layout.header.gridOffset = read<vec3f>(in);
+      if (!in.good())
+        throw std::runtime_error("tamr: truncated v1 file");
+
+      addFieldScalarSections(layout.sections,fieldMetas,scalars,
+                             layout.header.numCellsAcrossAllGrids);
+      layout.header.numSections = (uint32_t)layout.sections.size();
+      return layout;
+    }
+
+    Layout readLayout(std::istream &in)
+    {
+      in.seekg(0);
+      uint64_t fileMagic = read<uint64_t>(in);
+      if (!in.good())
+        throw std::runtime_error("tamr: could not read file header");
+      if (fileMagic == magic_v1)
+        return readLayout_v1(in);
+      if (fileMagic != magic)
+        throw std::runtime_error("wrong magic number");
+
+      in.seekg(0,std::ios::end);
+      const uint64_t fileSize = in.tellg();
+      // whatever the header and table of contents say, nothing may
+      // lie (or get allocated) beyond the end of the file
+      auto fitsInFile = [fileSize](uint64_t offset, uint64_t size) {
+        return offset <= fileSize && size <= fileSize-offset;
+      };
+
+      Layout layout;
+      in.seekg(0);
+      layout.header = read<Header>(in);
+      if (!in.good())
+        throw std::runtime_error("tamr: could not read file header");
+      if (layout.header.version < 2 || layout.header.version > version)
+        throw std::runtime_error("tamr: file has version "
+                                 +std::to_string(layout.header.version)
+                                 +", but this library only supports versions 2 to "
+                                 +std::to_string(version));
+      if (!fitsInFile(layout.header.tocOffset,
+                      uint64_t(layout.header.numSections)*sizeof(Section)))
+        throw std::runtime_error("tamr: table of contents exceeds the file");
+      layout.version = layout.header.version;
+      layout.sections.resize(layout.header.numSections);
+      in.seekg(layout.header.tocOffset);
+      in.read((char*)layout.sections.data(),
+              layout.sections.size()*sizeof(Section));
+      if (!in.good())
+        throw std::runtime_error("tamr: could not read table of contents");
+      for (auto &section : layout.sections)
+        // (FIELD_SCALARS sections describe ranges of the decoded
+        // SCALARS section, which may be bigger than the encoded one)
+        if (section.type != SECTION_FIELD_SCALARS &&
+            !fitsInFile(section.offset,section.size))
+          throw std::runtime_error("tamr: section exceeds the file");
+      return layout;
+    }
+
+    Model::SP readMetaData(std::istream &in, const Layout &layout)
+    {
+      Model::SP model = std::make_shared<Model>();
+      readSection(in,layout.get(SECTION_REFINEMENT_OF_LEVEL),model->refinementOfLevel);
+      model->numCellsAcrossAllGrids = layout.header.numCellsAcrossAllGrids;
+
+      in.seekg(layout.get(SECTION_FIELD_METAS).offset);
+      model->fieldMetas = readFieldMetas(in);
+
+      const Section &userMeta = layout.get(SECTION_USER_META);
+      model->userMeta.resize(userMeta.size);
+      in.seekg(userMeta.offset);
+      in.read((char*)model->userMeta.data(),userMeta.size);
+
+      model->gridOrigin = layout.header.gridOrigin;
+      model->gridOffset = layout.header.gridOffset;
+      if (layout.header.cellLayout > CELL_LAYOUT_MORTON)
+        throw std::runtime_error("tamr: unknown cell layout");
+      model->cellLayout = (CellLayout)layout.header.cellLayout;
+      return model;
+    }
+
+    ScalarReader::ScalarReader(std::istream &in, const Section &scalars, int numThreads)
+      : in(in), section(scalars), numThreads(numThreads)
+    {
+      if (section.encoding == ENCODING_RAW) {
+        if (section.size != section.count*sizeof(float))
+          throw std::runtime_error("tamr: inconsistent section size");
+        return;
+      }
+      if (section.encoding == ENCODING_TEMPORAL_DELTA)
+        throw std::runtime_error("tamr: temporal delta scalars can only be "
+                                 "read through a TimeSeries");
+      chunks = readChunkTable(section,[&](uint64_t offset, uint64_t size, void *dst) {
+        in.seekg(section.offset+offset);
+        in.read((char*)dst,size);
+        if (!in.good())
+          throw std::runtime_error("tamr: corrupt compressed section");
+      });
+    }
+
+    void ScalarReader::read(uint64_t begin, uint64_t count, float *dst)
+    {
+      if (count == 0) return;
+      if (begin+count > section.count)
+        throw std::runtime_error("tamr: scalars out of range");
+      if (section.encoding == ENCODING_RAW) {
+        in.seekg(section.offset+begin*sizeof(float));
+        in.read((char*)dst,count*sizeof(float));
+        if (!in.good())
+          throw std::runtime_error("tamr: error reading scalars");
+        return;
+      }
+
+      const uint64_t end = begin+count;
+      const std::vector<uint64_t> &scalarBegin = chunks.scalarBegin;
+      const std::vector<uint64_t> &byteBegin   = chunks.byteBegin;
+      const uint64_t firstChunk
+        = std::upper_bound(scalarBegin.begin(),scalarBegin.end(),begin)-scalarBegin.begin()-1;
+      const uint64_t lastChunk
+        = std::upper_bound(scalarBegin.begin(),scalarBegin.end(),end-1)-scalarBegin.begin()-1;
+
+      // read the encoded data of all chunks we need in one go
+      std::vector<uint8_t> encoded;
+      auto readChunks = [&](uint64_t first, uint64_t last) {
+        encoded.resize(byteBegin[last+1]-byteBegin[first]);
+        in.seekg(section.offset+byteBegin[first]);
+        in.read((char*)encoded.data(),encoded.size());
+        if (!in.good())
+          throw std::runtime_error("tamr: error reading scalars");
+      };
+
+      if (firstChunk == lastChunk) {
+        // small reads tend to come in sequence (say, grid by grid),
+        // so keep the decoded chunk around
+        if (cachedChunk != (int64_t)firstChunk) {
+          readChunks(firstChunk,firstChunk);
+          cache.resize(scalarBegin[firstChunk+1]-scalarBegin[firstChunk]);
+          cachedChunk = -1;
+          decodeChunk(encoded.data(),encoded.size(),cache.data(),cache.size());
+          cachedChunk = firstChunk;
+        }
+        memcpy(dst,cache.data()+(begin-scalarBegin[firstChunk]),count*sizeof(float));
+        return;
+      }
+
+      readChunks(firstChunk,lastChunk);
+      parallel_for(lastChunk-firstChunk+1,[&](size_t i){
+        const uint64_t chunkID    = firstChunk+i;
+        const uint64_t chunkBegin = scalarBegin[chunkID];
+        const uint64_t chunkEnd   = scalarBegin[chunkID+1];
+        const uint8_t *data = encoded.data()+(byteBegin[chunkID]-byteBegin[firstChunk]);
+        const uint64_t size = byteBegin[chunkID+1]-byteBegin[chunkID];
+        if (chunkBegin >= begin && chunkEnd <= end) {
+          decodeChunk(data,size,dst+(chunkBegin-begin),chunkEnd-chunkBegin);
+        } else {
+          std::vector<float> decoded(chunkEnd-chunkBegin);
+          decodeChunk(data,size,decoded.data(),decoded.size());
+          const uint64_t lo = std::max(begin,chunkBegin);
+          const uint64_t hi = std::min(end,chunkEnd);
+          memcpy(dst+(lo-begin),decoded.data()+(lo-chunkBegin),(hi-lo)*sizeof(float));
+        }
+      },numThreads);
+    }
+
+    // ------------------------------------------------------------------
+    // writing of files
+    // ------------------------------------------------------------------
+
+    PendingSection &FilePlan::add(uint32_t type, uint32_t index,
+                                  const void *data, uint64_t size, uint64_t count)
+    {
+      PendingSection pending;
+      pending.section = {};
+      pending.section.type     = type;
+      pending.section.index    = index;
+      pending.section.encoding = ENCODING_RAW;
+      pending.section.size     = size;
+      pending.section.count    = count;
+      if (size) pending.pieces.push_back({data,size,0});
+      sections.push_back(pending);
+      return sections.back();
+    }
+
+    PendingSection &FilePlan::add(uint32_t type, uint32_t index,
+                                  const std::string &bytes, uint64_t count)
+    {
+      PendingSection &pending = add(type,index,nullptr,0,count);
+      pending.bytes = bytes;
+      pending.section.size = bytes.size();
+      return pending;
+    }
+
+    uint64_t FilePlan::layOut()
+    {
+      header.magic       = magic;
+      header.version     = version;
+      header.numSections = (uint32_t)sections.size();
+      header.tocOffset   = sizeof(Header);
+
+      uint64_t fileSize = header.tocOffset + sections.size()*sizeof(Section);
+      const Section *scalars = nullptr;
+      for (auto &pending : sections) {
+        Section &section = pending.section;
+        if (section.type == SECTION_FIELD_SCALARS)
+          // these only refer into the scalars section, so can only
+          // get placed once that one is
+          continue;
+        section.offset = alignUp(fileSize,alignmentFor(section.size));
+        fileSize = section.offset + section.size;
+        if (section.type == SECTION_SCALARS)
+          scalars = &section;
+      }
+      for (auto &pending : sections) {
+        Section &section = pending.section;
+        if (section.type != SECTION_FIELD_SCALARS) continue;
+        if (!scalars)
+          throw std::runtime_error("tamr: field scalars without scalars section");
+        if (scalars->encoding == ENCODING_RAW) {
+          section.offset = scalars->offset + section.begin*sizeof(float);
+          section.size   = section.count*sizeof(float);
+        } else {
+          // encoded scalars can't be addressed by byte offset; only
+          // 'begin' and 'count' are meaningful
+          section.offset = scalars->offset;
+          section.size   = 0;
+        }
+      }
+      return fileSize;
+    }
+
+    void FilePlan::write(std::ostream &out) const
+    {
+      out.write((const char *)&header,sizeof(header));
+      for (auto &pending : sections)
+        out.write((const char *)&pending.section,sizeof(Section));
+
+      uint64_t pos = sizeof(header) + sections.size()*sizeof(Section);
+      const std::vector<char> zeroes(pageSize,0);
+      auto padTo = [&](uint64_t target) {
+        while (pos < target) {
+          uint64_t n = std::min(target-pos,(uint64_t)zeroes.size());
+          out.write(zeroes.data(),n);
+          pos += n;
+        }
+      };
+      for (auto &pending : sections) {
+        const Section &section = pending.section;
+        if (section.type == SECTION_FIELD_SCALARS) continue;
+        padTo(section.offset);
+        out.write(pending.bytes.data(),pending.bytes.size());
+        pos += pending.bytes.size();
+        for (auto &piece : pending.pieces) {
+          padTo(section.offset+piece.offset);
+          out.write((const char *)piece.data,piece.size);
+          pos += piece.size;
+        }
+        padTo(section.offset+section.size);
+      }
+    }
+
+    /*! if the model's fields exactly tile its scalars array, returns
+        the order in which they do; otherwise returns an empty
+        vector */
+    static std::vector<int> tilingOrderOfFields(const Model &model)
+    {
+      std::vector<int> order;
+      for (int i=0;i<(int)model.fieldMetas.size();i++)
+        order.push_back(i);
+      std::sort(order.begin(),order.end(),[&](int a, int b)
+      { return model.fieldMetas[a].offset < model.fieldMetas[b].offset; });
+      uint64_t end = 0;
+      for (int fieldID : order) {
+        const Model::FieldMeta &meta = model.fieldMetas[fieldID];
+        if (meta.offset != end) return {};
+        end += numScalarsOf(meta,model.numCellsAcrossAllGrids,model.scalars.size());
+      }
+      if (end != model.scalars.size()) return {};
+      return order;
+    }
+
+    FilePlan planFile(const Model &model)
+    {
+      FilePlan plan;
+      plan.header = {};
+      plan.header.numCellsAcrossAllGrids = model.numCellsAcrossAllGrids;
+      plan.header.gridOrigin = model.gridOrigin;
+      plan.header.gridOffset = model.gridOffset;
+      plan.header.cellLayout = model.cellLayout;
+
+      plan.add(SECTION_REFINEMENT_OF_LEVEL,0,
+               model.refinementOfLevel.data(),
+               model.refinementOfLevel.size()*sizeof(int),
+               model.refinementOfLevel.size());
+
+      // scalars go in as one section, but with each field starting
+      // at a 64-byte boundary - at least if the fields are laid out
+      // 'sanely'; otherwise we write the array exactly as it is.
+      std::vector<Model::FieldMeta> fieldMetas = model.fieldMetas;
+      std::vector<int> order = tilingOrderOfFields(model);
+      PendingSection &scalars
+        = plan.add(SECTION_SCALARS,0,
+                   model.scalars.data(),model.scalars.size()*sizeof(float),
+                   model.scalars.size());
+      if (!order.empty()) {
+        const uint64_t scalarsPerLine = sectionAlignment/sizeof(float);
+        scalars.pieces.clear();
+        uint64_t cursor = 0;
+        for (int fieldID : order) {
+          const Model::FieldMeta &meta = model.fieldMetas[fieldID];
+          uint64_t count
+            = numScalarsOf(meta,model.numCellsAcrossAllGrids,model.scalars.size());
+          cursor = alignUp(cursor,scalarsPerLine);
+          fieldMetas[fieldID].offset = cursor;
+          scalars.pieces.push_back({model.scalars.data()+meta.offset,
+                                    count*sizeof(float),
+                                    cursor*sizeof(float)});
+          cursor += count;
+        }
+        scalars.section.count = cursor;
+        scalars.section.size  = cursor*sizeof(float);
+      }
+      const uint64_t numScalars = scalars.section.count;
+
+      plan.add(SECTION_GRIDS,0,
+               model.grids.data(),model.grids.size()*sizeof(Model::Grid),
+               model.grids.size());
+      plan.add(SECTION_FIELD_METAS,0,
+               serializeFieldMetas(fieldMetas),fieldMetas.size());
+      plan.add(SECTION_USER_META,0,
+               model.userMeta,model.userMeta.size());
+
+      for (size_t fieldID=0;fieldID<fieldMetas.size();fieldID++) {
+        PendingSection &field = plan.add(SECTION_FIELD_SCALARS,(uint32_t)fieldID,
+                                         nullptr,0,0);
+        field.section.begin = fieldMetas[fieldID].offset;
+        field.section.count = numScalarsOf(fieldMetas[fieldID],
+                                           model.numCellsAcrossAllGrids,
+                                           numScalars);
+      }
+      return plan;
+    }
+
+  } // ::tamr::format
+} // ::tamr
@@ -0,0 +1,317 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! \file FileFormat.h describes the on-disk layout of .tamr files, and
+    provides the low-level helpers to read and write them.
+
+    v1 files are a purely sequential stream of magic_v1,
+    refinementOfLevel, scalars, grids, numCellsAcrossAllGrids,
+    fieldMetas, userMeta, gridOrigin and gridOffset.
+
+    v2 (and newer) files start with a 64-byte Header that points to a
+    table of contents (TOC) of Sections; every section's payload
+    starts at a multiple of 64 bytes (of the page size if the section
+    is at least a page big), so readers can seek - or map - directly
+    to whatever they need. */
+
+#pragma once
+
+#include "tinyAMR/Model.h"
+#include <iostream>
+#include <type_traits>
+
+namespace tamr {
+  namespace format {
+
+    /*! magic number of the original, un-versioned file format */
+    const uint64_t magic_v1 = 0x665674465ABABull;
+    /*! magic number of all versioned files, which start with a Header */
+    const uint64_t magic    = 0x665674465ABAC2ull;
+    /*! newest version this library can read, and what it writes */
+    const uint32_t version  = 2;
+
+    /*! every section starts at a multiple of this many bytes ... */
+    const uint64_t sectionAlignment = 64;
+    /*! ... and every section that is at least this big at a multiple of this */
+    const uint64_t pageSize = 4096;
+
+    typedef enum : uint32_t {
+      SECTION_REFINEMENT_OF_LEVEL = 1,
+      SECTION_SCALARS,
+      SECTION_GRIDS,
+      SECTION_FIELD_METAS,
+      SECTION_USER_META,
+      /*! one per field (Section::index is the field ID); describes
+          the range of the SCALARS section that holds this field's
+          scalars. This does not have a payload of its own */
+      SECTION_FIELD_SCALARS,
+      /*! for time series (see TimeSeries.h): one TimestepInfo per
+          timestep. Timestep 't''s scalars are in SCALARS section
+          #t, its grids in GRIDS section #topology */
+      SECTION_TIMESTEPS,
+      /*! optional, one per field (Section::index is the field ID):
+          the range1f of values of each grid's scalars of that
+          field, for all grids of dimension 0, then of dimension 1,
+          etc. See ValueRanges.h */
+      SECTION_VALUE_RANGES,
+      /*! optional, three of them, for the grids of the GRIDS
+          section: #0 is the uint64_t neighborBegin, #1 the uint32_t
+          neighbors, #2 the uint8_t kinds of a GridAdjacency. See
+          GridAdjacency.h */
+      SECTION_GRID_ADJACENCY,
+    } SectionType;
+
+    typedef enum : uint32_t {
+      ENCODING_RAW = 0,
+      /*! chunked, lossless compression of floats; only valid for
+          the SCALARS section. See Compression.h */
+      ENCODING_LOSSLESS,
+      /*! chunked (typically: one chunk per grid), error-bounded lossy
+          compression or quantization of floats; only valid for the
+          SCALARS section */
+      ENCODING_LOSSY,
+      /*! for time series: an ENCODING_LOSSLESS payload of the
+          bitwise XOR of this timestep's scalars with the previous
+          timestep's (which must have the same topology) */
+      ENCODING_TEMPORAL_DELTA,
+    } Encoding;
+
+    struct Header {
+      uint64_t magic;
+      uint32_t version;
+      uint32_t numSections;
+      /*! file offset of the table of Sections */
+      uint64_t tocOffset;
+      uint64_t numCellsAcrossAllGrids;
+      vec3f    gridOrigin;
+      vec3f    gridOffset;
+      /*! a CellLayout; always 0 (linear) in files written before
+          there were other layouts */
+      uint32_t cellLayout;
+      uint32_t reserved;
+    };
+
+    struct Section {
+      uint32_t type;
+      /*! which field (or other numbered entity) this section refers
+          to, if applicable; 0 otherwise */
+      uint32_t index;
+      uint32_t encoding;
+      uint32_t reserved;
+      /*! byte offset of this section's payload, counted from the
+          start of the file */
+      uint64_t offset;
+      /*! size of the payload, in bytes (as stored, ie, encoded) */
+      uint64_t size;
+      /*! number of elements (scalars, grids, ...) in this section */
+      uint64_t count;
+      /*! for sections that describe a sub-range of another section's
+          elements (such as FIELD_SCALARS) the index of the first
+          such element */
+      uint64_t begin;
+    };
+
+    struct TimestepInfo {
+      double   time;
+      /*! index of the GRIDS section this timestep uses */
+      uint32_t topology;
+      uint32_t reserved;
+      /*! number of cells across all grids of that topology */
+      uint64_t numCells;
+    };
+
+    /*! where in a file which section is; for v1 files this gets
+        reconstructed by scanning over the file */
+    struct Layout {
+      /*! returns the given section, or null if the file doesn't have it */
+      const Section *find(uint32_t type, uint32_t index=0) const;
+      /*! same as find, but throws an error if not found */
+      const Section &get(uint32_t type, uint32_t index=0) const;
+
+      /*! version of the file this layout was read from */
+      int                  version;
+      Header               header;
+      std::vector<Section> sections;
+    };
+
+    /*! reads (or, for v1 files, reconstructs) the layout of the file
+        that 'in' is reading from */
+    Layout readLayout(std::istream &in);
+
+    /*! reads everything of a model except its scalars and grids */
+    Model::SP readMetaData(std::istream &in, const Layout &layout);
+
+    inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+    { return ((value + alignment - 1)/alignment)*alignment; }
+
+    /*! alignment to use for a section of given size */
+    inline uint64_t alignmentFor(uint64_t sectionSize)
+    { return sectionSize >= pageSize ? pageSize : sectionAlignment; }
+
+    /*! number of scalars that given field has, computed from its
+        number of dimensions and the number of cells across all
+        grids, and clamped to the number of scalars actually
+        present */
+    uint64_t numScalarsOf(const Model::FieldMeta &meta,
+                          uint64_t numCellsAcrossAllGrids,
+                          uint64_t numScalars);
+
+    // ------------------------------------------------------------------
+    // writing of files
+    // ------------------------------------------------------------------
+
+    /*! a piece of memory that is to be written at given (relative)
+        offset of a section */
+    struct Piece {
+      const void *data;
+      uint64_t    size;
+      uint64_t    offset;
+    };
+
+    /*! a section that is to be written, and the pieces of memory
+        that make up its payload. Any bytes not covered by pieces get
+        written as zeroes. */
+    struct PendingSection {
+      Section              section;
+      std::vector<Piece>   pieces;
+      /*! storage for payloads that are not stored anywhere else
+          (such as serialized field metas) */
+      std::string          bytes;
+    };
+
+    /*! full description of a file to be written - header, sections,
+        and where each section's data comes from */
+    struct FilePlan {
+      /*! adds a section whose payload is a single piece of memory */
+      PendingSection &add(uint32_t type, uint32_t index,
+                          const void *data, uint64_t size, uint64_t count);
+      /*! adds a section whose payload is given by 'bytes' */
+      PendingSection &add(uint32_t type, uint32_t index,
+                          const std::string &bytes, uint64_t count);
+
+      /*! assigns (aligned) file offsets to all sections, with the
+          table of contents placed directly after the header; returns
+          total file size */
+      uint64_t layOut();
+
+      /*! writes entire file, sequentially, to given stream; must be
+          called after layOut() */
+      void write(std::ostream &out) const;
+
+      Header                      header;
+      /*! sections, in the order they'll appear in the file */
+      std::vector<PendingSection> sections;
+    };
+
+    /*! builds the plan for writing given model as a v2 file. Field
+        scalars get written such that each field starts on a 64-byte
+        boundary, so the field metas stored in the file may have
+        different offsets than the model's. */
+    FilePlan planFile(const Model &model);
+
+    // ------------------------------------------------------------------
+    // low-level (de-)serialization helpers
+    // ------------------------------------------------------------------
+
+    template<typename T> void write(std::ostream &out, const T &scalar)
+    { out.write((char*)&scalar,sizeof(scalar)); }
+
+    template<typename T> T read(std::istream &in)
+    { T scalar; in.read((char*)&scalar,sizeof(scalar)); return scalar; }
+
+    inline void writeString(std::ostream &out, const std::string &s)
+    {
+      write(out,(int)s.size());
+      out.write((char*)s.c_str(),s.size());
+    }
+
+    inline std::string readString(std::istream &in)
+    {
+      std::vector<char> chars(read<int>(in));
+      in.read((char*)chars.data(),chars.size());
+      chars.push_back(0);
+      return chars.data();
+    }
+
+    template<typename T>
+    void readVector(std::istream &in, std::vector<T> &vec)
+    {
+      vec.resize(read<size_t>(in));
+      in.read((char*)vec.data(),vec.size()*sizeof(T));
+    }
+
+    /*! serializes field metas the way they are stored in a
+        FIELD_METAS section (which is the same as in v1 files) */
+    std::string serializeFieldMetas(const std::vector<Model::FieldMeta> &metas);
+    std::vector<Model::FieldMeta> readFieldMetas(std::istream &in);
+
+    /*! where the chunks of an encoded SCALARS section are */
+    struct ChunkTable {
+      uint64_t numChunks() const { return scalarBegin.size()-1; }
+
+      /*! chunk 'i' holds scalars [scalarBegin[i],scalarBegin[i+1]),
+          and its encoded data is in bytes [byteBegin[i],byteBegin[i+1])
+          of the section's payload */
+      std::vector<uint64_t> scalarBegin;
+      std::vector<uint64_t> byteBegin;
+    };
+
+    /*! reads arbitrary ranges of scalars from a SCALARS section,
+        whatever that section's encoding; for compressed sections
+        this only decodes the chunks overlapping the requested range,
+        and keeps the last decoded chunk around for the next read */
+    struct ScalarReader {
+      ScalarReader(std::istream &in, const Section &scalars, int numThreads = 0);
+
+      /*! reads scalars [begin,begin+count) of the section into 'dst' */
+      void read(uint64_t begin, uint64_t count, float *dst);
+
+    private:
+      std::istream         &in;
+      const Section         section;
+      const int             numThreads;
+      /*! for encoded sections only */
+      ChunkTable            chunks;
+      int64_t               cachedChunk = -1;
+      std::vector<float>    cache;
+    };
+
+    /*! reads the payload of given section into 'array', which can be
+        either a std::vector or a tamr::Array; this only supports raw
+        sections, except for arrays of floats, which are assumed to
+        be the SCALARS section and may have any encoding */
+    template<typename ArrayT>
+    void readSection(std::istream &in, const Section &section, ArrayT &array)
+    {
+      typedef typename ArrayT::value_type T;
+      if constexpr (std::is_same<T,float>::value) {
+        if (section.encoding != ENCODING_RAW) {
+          array.resize(section.count);
+          ScalarReader(in,section).read(0,section.count,array.data());
+          return;
+        }
+      }
+      if (section.encoding != ENCODING_RAW)
+        throw std::runtime_error("tamr: unsupported section encoding");
+      if (section.size != section.count*sizeof(T))
+        throw std::runtime_error("tamr: inconsistent section size");
+      array.resize(section.count);
+      in.seekg(section.offset);
+      in.read((char*)array.data(),section.size);
+    }
+
+  } // ::tamr::format
+} // ::tamr
@@ -0,0 +1,157 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/GridAdjacency.h"
+#include "tinyAMR/parallel_for.h"
+#include <fstream>
+#include <algorithm>
+
+namespace tamr {
+  using namespace tamr::format;
+
+  GridAdjacency::SP GridAdjacency::compute(const Model &model, int numThreads)
+  {
+    const GridIndex index(model,numThreads);
+    return compute(index,numThreads);
+  }
+
+  GridAdjacency::SP GridAdjacency::compute(const GridIndex &index, int numThreads)
+  {
+    const Model &model = index.model;
+    const size_t numGrids = model.grids.size();
+
+    // grid bounds on the lattice of the finest level (or rather, of
+    // the least common multiple of all levels' refinements)
+    int64_t lcm = 1;
+    for (int refinement : model.refinementOfLevel) {
+      int64_t a = lcm, b = refinement;
+      while (b) { const int64_t t = a % b; a = b; b = t; }
+      lcm = lcm/a*refinement;
+    }
+    struct Bounds { int64_t lower[3], upper[3]; };
+    std::vector<Bounds> bounds(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      const Model::Grid &grid = model.grids[gridID];
+      const int64_t width = lcm/model.refinementOfLevel[grid.level];
+      for (int axis=0;axis<3;axis++) {
+        bounds[gridID].lower[axis] = int64_t(grid.origin[axis])*width;
+        bounds[gridID].upper[axis] = int64_t(grid.origin[axis]+grid.dims[axis])*width;
+      }
+    },numThreads);
+
+    // grids that touch are found by querying with slightly enlarged
+    // world-space bounds, and then classified exactly
+    const vec3f margin = vec3f(.25f/lcm)*model.gridOffset;
+    std::vector<std::vector<std::pair<uint32_t,uint8_t>>> neighborsOf(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      const box3f worldBounds = model.worldBounds(model.grids[gridID]);
+      const box3f query(worldBounds.lower-margin,worldBounds.upper+margin);
+      const Bounds &self = bounds[gridID];
+      index.forEachOverlapping(query,[&](size_t otherID) {
+        if (otherID == gridID) return;
+        const Bounds &other = bounds[otherID];
+        int numTouching = 0;
+        for (int axis=0;axis<3;axis++) {
+          const int64_t overlap
+            = std::min(self.upper[axis],other.upper[axis])
+            - std::max(self.lower[axis],other.lower[axis]);
+          if (overlap < 0) return;
+          numTouching += (overlap == 0);
+        }
+        const uint8_t kind
+          = numTouching == 0 ? ADJACENT_OVERLAP
+          : numTouching == 1 ? ADJACENT_FACE
+          : numTouching == 2 ? ADJACENT_EDGE
+          : ADJACENT_CORNER;
+        neighborsOf[gridID].push_back({(uint32_t)otherID,kind});
+      });
+      std::sort(neighborsOf[gridID].begin(),neighborsOf[gridID].end());
+    },numThreads);
+
+    GridAdjacency::SP result = std::make_shared<GridAdjacency>();
+    result->neighborBegin.resize(numGrids+1);
+    for (size_t gridID=0;gridID<numGrids;gridID++)
+      result->neighborBegin[gridID+1]
+        = result->neighborBegin[gridID]+neighborsOf[gridID].size();
+    result->neighbors.resize(result->neighborBegin[numGrids]);
+    result->kinds.resize(result->neighborBegin[numGrids]);
+    parallel_for(numGrids,[&](size_t gridID) {
+      uint64_t n = result->neighborBegin[gridID];
+      for (auto &neighbor : neighborsOf[gridID]) {
+        result->neighbors[n] = neighbor.first;
+        result->kinds[n]     = neighbor.second;
+        n++;
+      }
+    },numThreads);
+    return result;
+  }
+
+  GridAdjacency::SP GridAdjacency::load(const std::string &fileName)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    if (!in.good())
+      throw std::runtime_error("tamr::GridAdjacency: could not open '"+fileName+"'");
+    Layout layout = readLayout(in);
+    const Section *begins    = layout.find(SECTION_GRID_ADJACENCY,0);
+    const Section *neighbors = layout.find(SECTION_GRID_ADJACENCY,1);
+    const Section *kinds     = layout.find(SECTION_GRID_ADJACENCY,2);
+    if (!begins || !neighbors || !kinds) return {};
+    GridAdjacency::SP result = std::make_shared<GridAdjacency>();
+    readSection(in,*begins,result->neighborBegin);
+    readSection(in,*neighbors,result->neighbors);
+    readSection(in,*kinds,result->kinds);
+    if (!in.good())
+      throw std::runtime_error("tamr::GridAdjacency: error reading '"+fileName+"'");
+    if (result->neighborBegin.empty() ||
+        result->neighborBegin.size()-1 != layout.get(SECTION_GRIDS).count ||
+        result->neighborBegin.back() != result->neighbors.size() ||
+        result->neighbors.size() != result->kinds.size())
+      throw std::runtime_error("tamr::GridAdjacency: inconsistent adjacency in '"+fileName+"'");
+    // make sure forEachNeighbor() can't index out of bounds, whatever
+    // the file says
+    const size_t numGrids = result->numGrids();
+    bool valid = (result->neighborBegin[0] == 0);
+    for (size_t gridID=0;valid && gridID<numGrids;gridID++)
+      valid = result->neighborBegin[gridID] <= result->neighborBegin[gridID+1];
+    for (size_t n=0;valid && n<result->neighbors.size();n++)
+      valid = result->neighbors[n] < numGrids && result->kinds[n] <= ADJACENT_OVERLAP;
+    if (!valid)
+      throw std::runtime_error("tamr::GridAdjacency: corrupt adjacency in '"+fileName+"'");
+    return result;
+  }
+
+  namespace format {
+
+    void addGridAdjacency(FilePlan &plan, const Model &model,
+                          const IOOptions &options)
+    {
+      GridAdjacency::SP adjacency = GridAdjacency::compute(model,options.numThreads);
+      plan.add(SECTION_GRID_ADJACENCY,0,
+               std::string((const char *)adjacency->neighborBegin.data(),
+                           adjacency->neighborBegin.size()*sizeof(uint64_t)),
+               adjacency->neighborBegin.size());
+      plan.add(SECTION_GRID_ADJACENCY,1,
+               std::string((const char *)adjacency->neighbors.data(),
+                           adjacency->neighbors.size()*sizeof(uint32_t)),
+               adjacency->neighbors.size());
+      plan.add(SECTION_GRID_ADJACENCY,2,
+               std::string((const char *)adjacency->kinds.data(),
+                           adjacency->kinds.size()),
+               adjacency->kinds.size());
+    }
+
+  }
+} // ::tamr
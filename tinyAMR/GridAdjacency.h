@@ -0,0 +1,87 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/GridIndex.h"
+#include "tinyAMR/FileFormat.h"
+
+namespace tamr {
+
+  /*! for each grid, all other grids that touch it - across a face,
+      an edge, or a corner - or that overlap it, on whatever level,
+      so stencil operations (gradients, ghost cells, connected
+      components, ...) don't have to search for them. Stored in CSR
+      form: the neighbors of grid 'i' are
+      neighbors[neighborBegin[i]..neighborBegin[i+1]), sorted by grid
+      ID, with kinds[] saying how each of them touches grid 'i'. This
+      is symmetric: if 'j' is a neighbor of 'i' then 'i' is one of
+      'j', of the same kind.
+
+      Grids are compared exactly, on the lattice of the finest
+      level. These can be stored in .tamr files (see
+      IOOptions::storeGridAdjacency), and read from there without
+      reading any scalars. */
+  struct GridAdjacency {
+    typedef std::shared_ptr<GridAdjacency> SP;
+
+    typedef enum : uint8_t {
+      /*! the grids share part of a face (of non-zero area) */
+      ADJACENT_FACE = 0,
+      /*! the grids share part of an edge, but no face */
+      ADJACENT_EDGE,
+      /*! the grids share only a corner */
+      ADJACENT_CORNER,
+      /*! the grids' cells overlap, such as a coarse grid and a finer
+          one refining it */
+      ADJACENT_OVERLAP,
+    } Kind;
+
+    /*! finds the neighbors of all of the index's model's grids, with
+        the grids getting processed in parallel */
+    static SP compute(const GridIndex &index, int numThreads = 0);
+    /*! same, but builds a GridIndex for that first */
+    static SP compute(const Model &model, int numThreads = 0);
+
+    /*! reads the adjacency of the grids of given file; returns null
+        if the file doesn't store it */
+    static SP load(const std::string &fileName);
+
+    size_t numGrids() const { return neighborBegin.size()-1; }
+    size_t numNeighbors(size_t gridID) const
+    { return neighborBegin[gridID+1]-neighborBegin[gridID]; }
+
+    /*! calls lambda(neighborID,kind) for all neighbors of given grid */
+    template<typename Lambda>
+    void forEachNeighbor(size_t gridID, const Lambda &lambda) const
+    {
+      for (uint64_t n=neighborBegin[gridID];n<neighborBegin[gridID+1];n++)
+        lambda((size_t)neighbors[n],(Kind)kinds[n]);
+    }
+
+    std::vector<uint64_t> neighborBegin = { 0 };
+    std::vector<uint32_t> neighbors;
+    std::vector<uint8_t>  kinds;
+  };
+
+  namespace format {
+    /*! adds the GRID_ADJACENCY sections for given model to the given
+        plan (which must be the plan of that model) */
+    void addGridAdjacency(FilePlan &plan, const Model &model,
+                          const IOOptions &options);
+  }
+
+} // ::tamr
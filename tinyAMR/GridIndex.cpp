@@ -0,0 +1,165 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/GridIndex.h"
+#include "tinyAMR/parallel_for.h"
+#include <algorithm>
+#include <functional>
+
+namespace tamr {
+
+  /*! splits gridIDs[begin,end) in half, along the axis in which the
+      grids' centers are spread out the most; returns the middle */
+  static size_t splitInHalf(size_t begin, size_t end,
+                            std::vector<uint32_t> &gridIDs,
+                            const std::vector<box3f> &gridBounds)
+  {
+    box3f centers;
+    for (size_t i=begin;i<end;i++)
+      centers.extend(gridBounds[gridIDs[i]].center());
+    const vec3f size = centers.size();
+    const int axis
+      = (size.x >= size.y && size.x >= size.z) ? 0
+      : (size.y >= size.z ? 1 : 2);
+    const size_t mid = begin+(end-begin)/2;
+    std::nth_element(gridIDs.begin()+begin,gridIDs.begin()+mid,gridIDs.begin()+end,
+                     [&](uint32_t a, uint32_t b) {
+                       return gridBounds[a].center()[axis] < gridBounds[b].center()[axis];
+                     });
+    return mid;
+  }
+
+  GridIndex::GridIndex(const Model &model, int numThreads)
+    : model(model)
+  {
+    const size_t numGrids = model.grids.size();
+    if (numGrids == 0) return;
+    if (numGrids >= (1ull<<31))
+      throw std::runtime_error("tamr::GridIndex: too many grids");
+
+    std::vector<box3f> gridBounds(numGrids);
+    std::vector<uint32_t> gridIDs(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      gridBounds[gridID] = model.worldBounds(model.grids[gridID]);
+      gridIDs[gridID] = (uint32_t)gridID;
+    },numThreads);
+    nodes.resize(2*numGrids-1);
+
+    // split the top of the tree serially, until there are enough
+    // subtrees to build those in parallel
+    struct Subtree { uint32_t nodeID; size_t begin, end; };
+    std::vector<Subtree> subtrees;
+    std::vector<uint32_t> topNodes;
+    const size_t maxSubtrees = 4*(size_t)numThreadsToUse(numThreads);
+    std::function<void(uint32_t,size_t,size_t,size_t)> splitTop
+      = [&](uint32_t nodeID, size_t begin, size_t end, size_t numSubtrees) {
+      if (end-begin < 2 || numSubtrees >= maxSubtrees) {
+        subtrees.push_back({nodeID,begin,end});
+        return;
+      }
+      const size_t mid = splitInHalf(begin,end,gridIDs,gridBounds);
+      nodes[nodeID].isLeaf = 0;
+      nodes[nodeID].index  = nodeID+2*uint32_t(mid-begin);
+      topNodes.push_back(nodeID);
+      splitTop(nodeID+1,begin,mid,2*numSubtrees);
+      splitTop(nodes[nodeID].index,mid,end,2*numSubtrees);
+    };
+    splitTop(0,0,numGrids,1);
+
+    parallel_for(subtrees.size(),[&](size_t i) {
+      build(subtrees[i].nodeID,subtrees[i].begin,subtrees[i].end,gridIDs,gridBounds);
+    },numThreads);
+
+    // children come after their parents, so going backwards does
+    // children before parents
+    for (auto it=topNodes.rbegin();it!=topNodes.rend();++it) {
+      Node &node = nodes[*it];
+      node.bounds = box3f();
+      node.bounds.extend(nodes[*it+1].bounds);
+      node.bounds.extend(nodes[node.index].bounds);
+    }
+  }
+
+  void GridIndex::build(uint32_t nodeID, size_t begin, size_t end,
+                        std::vector<uint32_t> &gridIDs,
+                        const std::vector<box3f> &gridBounds)
+  {
+    Node &node = nodes[nodeID];
+    if (end-begin == 1) {
+      node.isLeaf = 1;
+      node.index  = gridIDs[begin];
+      node.bounds = gridBounds[gridIDs[begin]];
+      return;
+    }
+    const size_t mid = splitInHalf(begin,end,gridIDs,gridBounds);
+    node.isLeaf = 0;
+    node.index  = nodeID+2*uint32_t(mid-begin);
+    build(nodeID+1,begin,mid,gridIDs,gridBounds);
+    build(node.index,mid,end,gridIDs,gridBounds);
+    node.bounds = box3f();
+    node.bounds.extend(nodes[nodeID+1].bounds);
+    node.bounds.extend(nodes[node.index].bounds);
+  }
+
+  GridIndex::Hit GridIndex::locate(const vec3f &worldPoint) const
+  {
+    Hit hit;
+    if (nodes.empty()) return hit;
+    float bestWidth = INFINITY;
+    uint32_t stack[64];
+    int      stackDepth = 0;
+    stack[stackDepth++] = 0;
+    while (stackDepth > 0) {
+      const uint32_t nodeID = stack[--stackDepth];
+      const Node &node = nodes[nodeID];
+      if (!node.bounds.contains(worldPoint)) continue;
+      if (!node.isLeaf) {
+        stack[stackDepth++] = node.index;
+        stack[stackDepth++] = nodeID+1;
+        continue;
+      }
+      const Model::Grid &grid = model.grids[node.index];
+      const float width = model.cellWidth(grid.level);
+      if (width >= bestWidth) continue;
+      // half-open test, in the grid's own cells
+      const vec3f logical = (worldPoint-model.gridOrigin)/model.gridOffset;
+      const vec3f cellCoords = logical/width - vec3f(grid.origin);
+      const vec3i cell(int(floorf(cellCoords.x)),
+                       int(floorf(cellCoords.y)),
+                       int(floorf(cellCoords.z)));
+      if (cellCoords.x < 0.f || cellCoords.y < 0.f || cellCoords.z < 0.f ||
+          cell.x >= grid.dims.x || cell.y >= grid.dims.y || cell.z >= grid.dims.z)
+        continue;
+      bestWidth  = width;
+      hit.gridID = node.index;
+      hit.cell   = cell;
+    }
+    return hit;
+  }
+
+  std::vector<size_t> GridIndex::overlapping(const box3f &worldBox,
+                                             int minLevel, int maxLevel) const
+  {
+    std::vector<size_t> result;
+    forEachOverlapping(worldBox,[&](size_t gridID) {
+      const int level = model.grids[gridID].level;
+      if (level >= minLevel && level <= maxLevel)
+        result.push_back(gridID);
+    });
+    return result;
+  }
+
+} // ::tamr
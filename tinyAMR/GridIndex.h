@@ -0,0 +1,207 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Model.h"
+#include <cmath>
+
+namespace tamr {
+
+  /*! a bounding volume hierarchy over the (world-space) bounds of a
+      model's grids, for finding the grid(s) at a given point, or in
+      a given region, without looking at all grids. The index refers
+      to the model it was built for, so that model needs to outlive
+      it, and must not change its grids while the index exists. */
+  struct GridIndex {
+    typedef std::shared_ptr<GridIndex> SP;
+
+    /*! result of a point query */
+    struct Hit {
+      bool valid() const { return gridID >= 0; }
+
+      /*! the grid that contains the point, or -1 if none does */
+      int64_t gridID = -1;
+      /*! the cell of that grid that contains the point, relative to
+          that grid's origin */
+      vec3i   cell   = vec3i(0);
+    };
+
+    /*! builds the index over all grids of given model, in O(n log n),
+        using up to 'numThreads' threads */
+    GridIndex(const Model &model, int numThreads = 0);
+
+    /*! finds the finest grid (ie, the one with the smallest cells)
+        that contains given world-space point, and the cell of that
+        grid that the point is in. Grids are considered to contain
+        their lower, but not their upper, faces */
+    Hit locate(const vec3f &worldPoint) const;
+
+    /*! all grids whose level is in [minLevel,maxLevel] and whose
+        world-space bounds overlap the given box */
+    std::vector<size_t> overlapping(const box3f &worldBox,
+                                    int minLevel = 0, int maxLevel = INT_MAX) const;
+
+    /*! calls lambda(gridID) for all grids whose world-space bounds
+        overlap the given box */
+    template<typename Lambda>
+    void forEachOverlapping(const box3f &worldBox, const Lambda &lambda) const;
+
+    /*! calls lambda(gridID,tEnter,tExit) for all grids whose
+        world-space bounds the ray org+t*dir overlaps for some t in
+        [tMin,tMax], with [tEnter,tExit] being that overlap */
+    template<typename Lambda>
+    void forEachIntersected(const vec3f &org, const vec3f &dir,
+                            float tMin, float tMax, const Lambda &lambda) const;
+
+    /*! like forEachIntersected(), but only looks for the first of
+        those grids for which accept(gridID,tEnter,tExit) is true:
+        returns that grid's tEnter (or INFINITY if there is none),
+        visiting nodes front to back and skipping everything behind
+        the closest grid found so far */
+    template<typename Accept>
+    float firstIntersected(const vec3f &org, const vec3f &dir,
+                           float tMin, float tMax, const Accept &accept) const;
+
+    /*! one node of the BVH; with 2n-1 nodes for n grids. Inner nodes'
+        first child comes right after them */
+    struct Node {
+      box3f    bounds;
+      /*! for leaves: 1; for inner nodes: 0 */
+      uint32_t isLeaf;
+      /*! for leaves: the grid ID; for inner nodes: the second child */
+      uint32_t index;
+    };
+
+    std::vector<Node> nodes;
+    const Model      &model;
+
+  private:
+    /*! builds the subtree over gridIDs[begin,end) at 'nodeID' */
+    void build(uint32_t nodeID, size_t begin, size_t end,
+               std::vector<uint32_t> &gridIDs,
+               const std::vector<box3f> &gridBounds);
+  };
+
+  template<typename Lambda>
+  void GridIndex::forEachOverlapping(const box3f &worldBox, const Lambda &lambda) const
+  {
+    if (nodes.empty()) return;
+    uint32_t stack[64];
+    int      stackDepth = 0;
+    stack[stackDepth++] = 0;
+    while (stackDepth > 0) {
+      const uint32_t nodeID = stack[--stackDepth];
+      const Node &node = nodes[nodeID];
+      if (!node.bounds.overlaps(worldBox)) continue;
+      if (node.isLeaf) {
+        lambda((size_t)node.index);
+        continue;
+      }
+      stack[stackDepth++] = node.index;
+      stack[stackDepth++] = nodeID+1;
+    }
+  }
+
+  /*! clips [tMin,tMax] to where the ray with given origin and
+      reciprocal direction is inside given box; returns false if that
+      leaves nothing */
+  inline bool clipRay(const box3f &box, const vec3f &org, const vec3f &rcpDir,
+                      float &tMin, float &tMax)
+  {
+    const vec3f t0 = (box.lower-org)*rcpDir;
+    const vec3f t1 = (box.upper-org)*rcpDir;
+    tMin = std::max(tMin,reduce_max(min(t0,t1)));
+    tMax = std::min(tMax,reduce_min(max(t0,t1)));
+    return tMin <= tMax;
+  }
+
+  /*! 1/dir, but with huge instead of infinite (or NaN) values for
+      zero components, so clipRay() works for rays parallel to an axis */
+  inline vec3f safeRcp(const vec3f &dir)
+  {
+    auto rcp = [](float f) {
+      return fabsf(f) < 1e-20f ? copysignf(1e20f,f) : 1.f/f;
+    };
+    return vec3f(rcp(dir.x),rcp(dir.y),rcp(dir.z));
+  }
+
+  template<typename Lambda>
+  void GridIndex::forEachIntersected(const vec3f &org, const vec3f &dir,
+                                     float tMin, float tMax,
+                                     const Lambda &lambda) const
+  {
+    if (nodes.empty()) return;
+    const vec3f rcpDir = safeRcp(dir);
+    uint32_t stack[64];
+    int      stackDepth = 0;
+    stack[stackDepth++] = 0;
+    while (stackDepth > 0) {
+      const uint32_t nodeID = stack[--stackDepth];
+      const Node &node = nodes[nodeID];
+      float t0 = tMin, t1 = tMax;
+      if (!clipRay(node.bounds,org,rcpDir,t0,t1)) continue;
+      if (node.isLeaf) {
+        lambda((size_t)node.index,t0,t1);
+        continue;
+      }
+      stack[stackDepth++] = node.index;
+      stack[stackDepth++] = nodeID+1;
+    }
+  }
+
+  template<typename Accept>
+  float GridIndex::firstIntersected(const vec3f &org, const vec3f &dir,
+                                    float tMin, float tMax,
+                                    const Accept &accept) const
+  {
+    float tFirst = INFINITY;
+    if (nodes.empty()) return tFirst;
+    const vec3f rcpDir = safeRcp(dir);
+    struct Entry { uint32_t nodeID; float t0; };
+    Entry stack[64];
+    int   stackDepth = 0;
+    float t0 = tMin, t1 = tMax;
+    if (!clipRay(nodes[0].bounds,org,rcpDir,t0,t1)) return tFirst;
+    stack[stackDepth++] = { 0, t0 };
+    while (stackDepth > 0) {
+      const Entry entry = stack[--stackDepth];
+      if (entry.t0 >= tFirst) continue;
+      const Node &node = nodes[entry.nodeID];
+      if (node.isLeaf) {
+        t0 = tMin; t1 = tMax;
+        clipRay(node.bounds,org,rcpDir,t0,t1);
+        if (accept((size_t)node.index,t0,t1))
+          tFirst = std::min(tFirst,t0);
+        continue;
+      }
+      // push the farther child first, so the nearer one gets popped
+      // (and likely shrinks tFirst) first
+      Entry children[2] = { { entry.nodeID+1, tMin }, { node.index, tMin } };
+      bool  hit[2];
+      for (int i=0;i<2;i++) {
+        float tExit = std::min(tMax,tFirst);
+        hit[i] = clipRay(nodes[children[i].nodeID].bounds,org,rcpDir,
+                         children[i].t0,tExit);
+      }
+      const int nearer = (hit[1] && (!hit[0] || children[1].t0 < children[0].t0)) ? 1 : 0;
+      if (hit[1-nearer]) stack[stackDepth++] = children[1-nearer];
+      if (hit[nearer])   stack[stackDepth++] = children[nearer];
+    }
+    return tFirst;
+  }
+
+} // ::tamr
@@ -0,0 +1,110 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/Interpolator.h"
+#include "tinyAMR/parallel_for.h"
+
+namespace tamr {
+
+  Interpolator::Interpolator(const Model &model, int numThreads)
+    : model(model),
+      index(model,numThreads)
+  {
+    const size_t numGrids = model.grids.size();
+
+    // a cell is a leaf unless its center is inside a grid with
+    // smaller cells
+    const Coverage::SP coverage = Coverage::compute(index,numThreads);
+    leaf.assign(model.numCellsAcrossAllGrids,1);
+    std::vector<uint8_t> hasLeaves(numGrids,0);
+    parallel_for(numGrids,[&](size_t gridID) {
+      const Model::Grid &grid = model.grids[gridID];
+      const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+      for (uint64_t i=0;i<numCells;i++)
+        if (coverage->isCovered(gridID,i)) leaf[grid.offset+i] = 0;
+      hasLeaves[gridID] = coverage->numActiveCells[gridID] > 0;
+    },numThreads);
+
+    // a leaf cell's basis function reaches up to half a cell width
+    // outside its grid
+    float maxWidth = 0.f;
+    for (auto &grid : model.grids)
+      maxWidth = std::max(maxWidth,model.cellWidth(grid.level));
+    const vec3f maxReach = vec3f(.5f*maxWidth)*model.gridOffset;
+    std::vector<std::vector<uint32_t>> neighborsOf(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      const box3f bounds = model.logicalBounds(model.grids[gridID]);
+      const box3f worldBounds = model.worldBounds(model.grids[gridID]);
+      const box3f query(worldBounds.lower-maxReach,worldBounds.upper+maxReach);
+      index.forEachOverlapping(query,[&](size_t otherID) {
+        if (!hasLeaves[otherID]) return;
+        const Model::Grid &other = model.grids[otherID];
+        const vec3f reach = vec3f(.5f*model.cellWidth(other.level));
+        const box3f otherBounds = model.logicalBounds(other);
+        if (box3f(otherBounds.lower-reach,otherBounds.upper+reach).overlaps(bounds))
+          neighborsOf[gridID].push_back((uint32_t)otherID);
+      });
+    },numThreads);
+
+    neighborBegin.resize(numGrids+1);
+    neighborBegin[0] = 0;
+    for (size_t gridID=0;gridID<numGrids;gridID++)
+      neighborBegin[gridID+1] = neighborBegin[gridID]+neighborsOf[gridID].size();
+    neighbors.resize(neighborBegin[numGrids]);
+    parallel_for(numGrids,[&](size_t gridID) {
+      std::copy(neighborsOf[gridID].begin(),neighborsOf[gridID].end(),
+                neighbors.begin()+neighborBegin[gridID]);
+    },numThreads);
+  }
+
+  float Interpolator::interpolate(int fieldID, const vec3f &worldPoint, int dim) const
+  {
+    const Model::FieldMeta &meta = model.fieldMetas.at(fieldID);
+    if (dim < 0 || dim >= meta.numDimensions)
+      throw std::runtime_error("tamr::Interpolator: invalid field dimension");
+    const GridIndex::Hit hit = index.locate(worldPoint);
+    if (!hit.valid()) return outside;
+
+    const float *fieldScalars
+      = model.scalars.data()+meta.offset+dim*model.numCellsAcrossAllGrids;
+    const vec3f logical = (worldPoint-model.gridOrigin)/model.gridOffset;
+    float sum = 0.f, weights = 0.f;
+    for (uint64_t n=neighborBegin[hit.gridID];n<neighborBegin[hit.gridID+1];n++) {
+      const Model::Grid &grid = model.grids[neighbors[n]];
+      // position relative to this grid's cell centers
+      const vec3f pos
+        = logical/model.cellWidth(grid.level)-vec3f(grid.origin)-vec3f(.5f);
+      const vec3i lower(int(floorf(pos.x)),int(floorf(pos.y)),int(floorf(pos.z)));
+      for (int corner=0;corner<8;corner++) {
+        const vec3i cell = lower+vec3i(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+        if (cell.x < 0 || cell.y < 0 || cell.z < 0 ||
+            cell.x >= grid.dims.x || cell.y >= grid.dims.y || cell.z >= grid.dims.z)
+          continue;
+        const uint64_t scalarID = grid.offset+model.cellIndex(grid,cell);
+        if (!leaf[scalarID]) continue;
+        const float weight
+          = (1.f-fabsf(pos.x-cell.x))
+          * (1.f-fabsf(pos.y-cell.y))
+          * (1.f-fabsf(pos.z-cell.z));
+        if (weight <= 0.f) continue;
+        sum     += weight*fieldScalars[scalarID];
+        weights += weight;
+      }
+    }
+    return weights > 0.f ? sum/weights : outside;
+  }
+
+} // ::tamr
@@ -0,0 +1,72 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Coverage.h"
+#include <cmath>
+
+namespace tamr {
+
+  /*! continuous reconstruction of a model's fields across levels,
+      with the 'basis function' method (Wald et al, "CPU Volume
+      Rendering of Adaptive Mesh Refinement Data", 2017): each leaf
+      cell - ie, each cell that isn't covered by a finer grid - has a
+      tent-shaped basis function that is 1 at its center and falls
+      off to 0 one cell width away from it; the value at a point is
+      the weighted average of the values of all leaf cells whose
+      basis functions are non-zero there. Within a level this is
+      trilinear interpolation; across level boundaries it is still
+      continuous.
+
+      For this, the interpolator precomputes which cells are leaves,
+      and for each grid which grids have cells whose basis functions
+      reach into it. Like GridIndex, this refers to the model it was
+      created for. All queries are const, and thread-safe. */
+  struct Interpolator {
+    typedef std::shared_ptr<Interpolator> SP;
+
+    Interpolator(const Model &model, int numThreads = 0);
+
+    /*! value of given dimension of given field at given world-space
+        point; 'outside' if the point isn't in any grid. Throws if the
+        model has no such field or dimension */
+    float interpolate(int fieldID, const vec3f &worldPoint, int dim = 0) const;
+
+    /*! whether given cell of given grid is a leaf */
+    bool isLeaf(size_t gridID, const vec3i &cell) const
+    {
+      const Model::Grid &grid = model.grids[gridID];
+      return leaf[grid.offset+model.cellIndex(grid,cell)];
+    }
+
+    /*! value for points that aren't in any grid */
+    float outside = NAN;
+
+    const Model    &model;
+    const GridIndex index;
+
+    /*! one entry per cell, in the same order as the model's scalars
+        (of any one field); 1 for leaf cells, 0 for all others */
+    std::vector<uint8_t>  leaf;
+    /*! for grid 'i', neighbors[neighborBegin[i]..neighborBegin[i+1])
+        are all grids (including 'i' itself) with leaf cells whose
+        basis functions overlap grid 'i' */
+    std::vector<uint64_t> neighborBegin;
+    std::vector<uint32_t> neighbors;
+  };
+
+} // ::tamr
@@ -0,0 +1,481 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/IsoSurface.h"
+#include "tinyAMR/parallel_for.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+
+namespace tamr {
+
+  /*! an edge of the tetrahedral mesh, by its two end points (in
+      lattice coordinates, see Extractor), with a < b; each vertex of
+      the surface is on exactly one such edge */
+  struct LatticeEdge {
+    vec3i a, b;
+  };
+
+  inline bool operator<(const vec3i &a, const vec3i &b)
+  {
+    return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+  }
+
+  inline bool operator<(const LatticeEdge &x, const LatticeEdge &y)
+  {
+    return x.a == y.a ? x.b < y.b : x.a < y.a;
+  }
+
+  inline bool operator==(const LatticeEdge &x, const LatticeEdge &y)
+  {
+    return x.a == y.a && x.b == y.b;
+  }
+
+  inline uint64_t hash(const LatticeEdge &edge)
+  {
+    const int32_t coords[6]
+      = { edge.a.x, edge.a.y, edge.a.z, edge.b.x, edge.b.y, edge.b.z };
+    uint64_t h = 0;
+    for (int i=0;i<6;i++)
+      h = (h ^ (uint32_t)coords[i])*0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 32);
+  }
+
+  inline int gcd(int a, int b)
+  {
+    while (b) { const int t = a % b; a = b; b = t; }
+    return a;
+  }
+
+  /*! a surface vertex, before merging */
+  struct EmittedVertex {
+    LatticeEdge edge;
+    vec3f       position;
+  };
+
+  /*! everything needed to extract the surface, for all grids. All
+      points of the tetrahedral mesh - cell corners, face centers,
+      and cell centers, on all levels - are on an integer 'lattice'
+      whose spacing is half the width of the finest cells, so they
+      can be compared exactly */
+  struct Extractor {
+    Extractor(const Interpolator &interpolator, int fieldID, float isoValue, int dim);
+
+    vec3f toWorld(const vec3i &p) const
+    { return model.gridOrigin+vec3f(p)*latticeWidth*model.gridOffset; }
+
+    /*! width (in lattice units) of the finest cell at given point;
+        INT_MAX if that's not in any grid */
+    int cellWidthAt(const vec3f &p) const;
+
+    /*! value of the field at given lattice point */
+    float valueAt(const vec3i &p) const;
+
+    /*! appends the mesh points on the edge from 'begin', 'length'
+        lattice units along 'axis', to 'points', excluding its end
+        point. The edge gets split as finely as the finest cells
+        around it; 'simple' means there aren't any */
+    void edgePoints(const vec3i &begin, int axis, int length, bool simple,
+                    std::vector<vec3i> &points) const;
+
+    /*! extracts the surface within all leaf cells of given grid */
+    void extractGrid(size_t gridID, std::vector<EmittedVertex> &out) const;
+
+    const Interpolator &interpolator;
+    const Model        &model;
+    const int           fieldID;
+    const int           dim;
+    const float         isoValue;
+    /*! spacing of the lattice, in logical space */
+    float               latticeWidth;
+    /*! width of a cell on given level, in lattice units */
+    std::vector<int>    widthOfLevel;
+  };
+
+  Extractor::Extractor(const Interpolator &interpolator, int fieldID,
+                       float isoValue, int dim)
+    : interpolator(interpolator),
+      model(interpolator.model),
+      fieldID(fieldID),
+      dim(dim),
+      isoValue(isoValue)
+  {
+    // least common multiple of all levels' refinements; usually
+    // just that of the finest level
+    int lcm = 1;
+    for (int refinement : model.refinementOfLevel)
+      lcm = lcm/gcd(lcm,refinement)*refinement;
+    latticeWidth = 1.f/(2*lcm);
+    for (int refinement : model.refinementOfLevel)
+      widthOfLevel.push_back(2*lcm/refinement);
+  }
+
+  int Extractor::cellWidthAt(const vec3f &p) const
+  {
+    const GridIndex::Hit hit
+      = interpolator.index.locate(model.gridOrigin+p*latticeWidth*model.gridOffset);
+    return hit.valid() ? widthOfLevel[model.grids[hit.gridID].level] : INT_MAX;
+  }
+
+  float Extractor::valueAt(const vec3i &p) const
+  {
+    float value = interpolator.interpolate(fieldID,toWorld(p),dim);
+    if (!std::isnan(value) && value != interpolator.outside)
+      return value;
+    // points on the model's upper boundaries aren't inside any grid
+    // (grids are half-open); use a value from right next to them
+    const float nudge = 1e-2f;
+    for (int i=0;i<8;i++) {
+      const vec3f q = vec3f(p)+vec3f(i & 1 ? -nudge : nudge,
+                                     i & 2 ? -nudge : nudge,
+                                     i & 4 ? -nudge : nudge);
+      value = interpolator.interpolate(fieldID,model.gridOrigin+q*latticeWidth*model.gridOffset,dim);
+      if (!std::isnan(value) && value != interpolator.outside)
+        break;
+    }
+    return value;
+  }
+
+  void Extractor::edgePoints(const vec3i &begin, int axis, int length, bool simple,
+                             std::vector<vec3i> &points) const
+  {
+    if (!simple) {
+      // the finest cell on any of the four sides of the edge
+      vec3f center = vec3f(begin);
+      center[axis] += .5f*length;
+      const int u = (axis+1)%3, v = (axis+2)%3;
+      int finest = INT_MAX;
+      for (int i=0;i<4;i++) {
+        vec3f probe = center;
+        probe[u] += i & 1 ? .5f : -.5f;
+        probe[v] += i & 2 ? .5f : -.5f;
+        finest = std::min(finest,cellWidthAt(probe));
+      }
+      if (finest < length) {
+        const int piece = gcd(length,finest);
+        for (int i=0;i<length;i+=piece) {
+          vec3i pieceBegin = begin;
+          pieceBegin[axis] += i;
+          edgePoints(pieceBegin,axis,piece,false,points);
+        }
+        return;
+      }
+    }
+    points.push_back(begin);
+  }
+
+  void Extractor::extractGrid(size_t gridID, std::vector<EmittedVertex> &out) const
+  {
+    const Model::Grid &grid = model.grids[gridID];
+    const int   width = widthOfLevel[grid.level];
+    const vec3i base  = grid.origin*width;
+
+    // the field at all of the grid's cell corners
+    const vec3i numCorners = grid.dims+vec3i(1);
+    std::vector<float> corners(size_t(numCorners.x)*numCorners.y*numCorners.z);
+    for (int iz=0;iz<numCorners.z;iz++)
+      for (int iy=0;iy<numCorners.y;iy++)
+        for (int ix=0;ix<numCorners.x;ix++)
+          corners[ix+numCorners.x*(iy+size_t(numCorners.y)*iz)]
+            = valueAt(base+vec3i(ix,iy,iz)*width);
+    auto value = [&](const vec3i &p) -> float {
+      const vec3i rel = p-base;
+      if (rel.x % width || rel.y % width || rel.z % width ||
+          rel.x < 0 || rel.y < 0 || rel.z < 0)
+        return valueAt(p);
+      const vec3i corner = rel/width;
+      if (corner.x >= numCorners.x || corner.y >= numCorners.y || corner.z >= numCorners.z)
+        return valueAt(p);
+      return corners[corner.x+numCorners.x*(corner.y+size_t(numCorners.y)*corner.z)];
+    };
+
+    // width of the finest cell at the center of each of the grid's
+    // cells, and of those one layer around the grid, with the
+    // latter shifted by one
+    const vec3i numAround = grid.dims+vec3i(2);
+    std::vector<int> around(size_t(numAround.x)*numAround.y*numAround.z);
+    for (int iz=0;iz<numAround.z;iz++)
+      for (int iy=0;iy<numAround.y;iy++)
+        for (int ix=0;ix<numAround.x;ix++) {
+          const vec3i cell = vec3i(ix,iy,iz)-vec3i(1);
+          int &w = around[ix+numAround.x*(iy+size_t(numAround.y)*iz)];
+          if (cell.x >= 0 && cell.y >= 0 && cell.z >= 0 &&
+              cell.x < grid.dims.x && cell.y < grid.dims.y && cell.z < grid.dims.z)
+            w = interpolator.isLeaf(gridID,cell) ? width : 0;
+          else
+            w = cellWidthAt(vec3f(base+cell*width+vec3i(width/2)));
+        }
+    auto neighborWidth = [&](const vec3i &shifted) {
+      return around[shifted.x+numAround.x*(shifted.y+size_t(numAround.y)*shifted.z)];
+    };
+
+    // surface vertex on the mesh edge between two points, if the
+    // field crosses the iso value there; computed the same way from
+    // whichever side we come
+    auto emit = [&](vec3i a, float va, vec3i b, float vb) {
+      if (b < a) { std::swap(a,b); std::swap(va,vb); }
+      float t = (isoValue-va)/(vb-va);
+      if (!(t >= 0.f && t <= 1.f)) t = .5f;
+      const vec3f pa = toWorld(a), pb = toWorld(b);
+      out.push_back({{a,b},pa+t*(pb-pa)});
+    };
+    auto orient = [&](size_t first, const vec3f &towardsLower) {
+      const vec3f normal = cross(out[first+1].position-out[first].position,
+                                 out[first+2].position-out[first].position);
+      if (dot(normal,towardsLower) < 0.f)
+        std::swap(out[first+1],out[first+2]);
+    };
+    auto tetrahedron = [&](const vec3i *p, const float *v) {
+      int in[4], numIn = 0, outside[4], numOut = 0;
+      for (int i=0;i<4;i++)
+        if (v[i] >= isoValue) in[numIn++] = i; else outside[numOut++] = i;
+      if (numIn == 0 || numOut == 0) return;
+      vec3f inCenter(0.f), outCenter(0.f);
+      for (int i=0;i<numIn;i++)  inCenter  = inCenter+toWorld(p[in[i]]);
+      for (int i=0;i<numOut;i++) outCenter = outCenter+toWorld(p[outside[i]]);
+      const vec3f towardsLower = outCenter*(1.f/numOut)-inCenter*(1.f/numIn);
+      if (numIn == 2) {
+        const int a = in[0], b = in[1], c = outside[0], d = outside[1];
+        const size_t first = out.size();
+        emit(p[a],v[a],p[c],v[c]);
+        emit(p[a],v[a],p[d],v[d]);
+        emit(p[b],v[b],p[d],v[d]);
+        out.push_back(out[first]);
+        out.push_back(out[first+2]);
+        emit(p[b],v[b],p[c],v[c]);
+        orient(first,towardsLower);
+        orient(first+3,towardsLower);
+      } else {
+        const int lone = numIn == 1 ? in[0] : outside[0];
+        const size_t first = out.size();
+        for (int i=0;i<4;i++)
+          if (i != lone) emit(p[lone],v[lone],p[i],v[i]);
+        orient(first,towardsLower);
+      }
+    };
+
+    std::vector<vec3i> loop, reversed;
+    std::vector<float> values;
+    // the pyramid from the cell center to the face of side 'size'
+    // starting at 'lower', spanned by axes u and v, with 'outward'
+    // pointing along 'axis' away from the cell
+    std::function<void(const vec3i &, int, float, int, bool,
+                       const vec3i &, float)> face
+      = [&](const vec3i &lower, int axis, float outward, int size, bool simple,
+            const vec3i &center, float centerValue) {
+      const int u = std::min((axis+1)%3,(axis+2)%3);
+      const int v = std::max((axis+1)%3,(axis+2)%3);
+      if (!simple) {
+        // if there are finer cells on the other side, split the face
+        // the same way those do
+        vec3f probe = vec3f(lower);
+        probe[u] += .5f*size;
+        probe[v] += .5f*size;
+        probe[axis] += .5f*outward;
+        const int neighborWidth = cellWidthAt(probe);
+        if (neighborWidth < size) {
+          const int piece = gcd(size,neighborWidth);
+          for (int j=0;j<size;j+=piece)
+            for (int i=0;i<size;i+=piece) {
+              vec3i subLower = lower;
+              subLower[u] += i;
+              subLower[v] += j;
+              face(subLower,axis,outward,piece,false,center,centerValue);
+            }
+          return;
+        }
+      }
+      // the face's boundary, always built in the same order, so both
+      // cells that share the face get the same face center value
+      vec3i c1 = lower, c2 = lower, c3 = lower;
+      c1[u] += size;
+      c2[u] += size; c2[v] += size;
+      c3[v] += size;
+      loop.clear();
+      edgePoints(lower,u,size,simple,loop);
+      edgePoints(c1,v,size,simple,loop);
+      loop.push_back(c2);
+      reversed.clear();
+      edgePoints(c3,u,size,simple,reversed);
+      loop.insert(loop.end(),reversed.rbegin(),reversed.rend()-1);
+      loop.push_back(c3);
+      reversed.clear();
+      edgePoints(lower,v,size,simple,reversed);
+      loop.insert(loop.end(),reversed.rbegin(),reversed.rend()-1);
+
+      values.resize(loop.size());
+      float faceValue = 0.f;
+      for (size_t i=0;i<loop.size();i++)
+        faceValue += (values[i] = value(loop[i]));
+      faceValue /= loop.size();
+      vec3i faceCenter = lower;
+      faceCenter[u] += size/2;
+      faceCenter[v] += size/2;
+      for (size_t i=0;i<loop.size();i++) {
+        const size_t next = (i+1)%loop.size();
+        const vec3i p[4] = { center, faceCenter, loop[i], loop[next] };
+        const float pv[4] = { centerValue, faceValue, values[i], values[next] };
+        tetrahedron(p,pv);
+      }
+    };
+
+    for (int iz=0;iz<grid.dims.z;iz++)
+      for (int iy=0;iy<grid.dims.y;iy++)
+        for (int ix=0;ix<grid.dims.x;ix++) {
+          const vec3i cell(ix,iy,iz);
+          if (!interpolator.isLeaf(gridID,cell)) continue;
+
+          // if none of the cells around this one is finer, none of
+          // its faces and edges need to be split
+          bool simple = true;
+          for (int i=0;i<27 && simple;i++)
+            simple = neighborWidth(cell+vec3i(i%3,(i/3)%3,i/9)) >= width;
+
+          const vec3i lower = base+cell*width;
+          float cornerValues[8];
+          int numIn = 0;
+          for (int i=0;i<8;i++) {
+            cornerValues[i] = value(lower+vec3i(i&1,(i>>1)&1,(i>>2)&1)*width);
+            numIn += cornerValues[i] >= isoValue;
+          }
+          // without finer neighbors, all values in this cell are
+          // averages of its corners' values
+          if (simple && (numIn == 0 || numIn == 8)) continue;
+
+          const vec3i center = lower+vec3i(width/2);
+          float centerValue = 0.f;
+          for (int i=0;i<8;i++) centerValue += cornerValues[i];
+          centerValue *= 1.f/8.f;
+          for (int axis=0;axis<3;axis++)
+            for (int side=0;side<2;side++) {
+              vec3i faceLower = lower;
+              faceLower[axis] += side*width;
+              face(faceLower,axis,side ? 1.f : -1.f,width,simple,center,centerValue);
+            }
+        }
+  }
+
+  IsoSurface::SP IsoSurface::extract(const Interpolator &interpolator,
+                                     int fieldID, float isoValue, int dim,
+                                     const ValueRanges *ranges,
+                                     int numThreads)
+  {
+    const Model &model = interpolator.model;
+    const size_t numGrids = model.grids.size();
+    ValueRanges::SP computedRanges;
+    if (!ranges) {
+      computedRanges = ValueRanges::compute(model,fieldID,numThreads);
+      ranges = computedRanges.get();
+    }
+    if (ranges->numGrids != numGrids)
+      throw std::runtime_error("tamr::IsoSurface: value ranges are for a different model");
+
+    // the field within a grid is an average of the values of those
+    // grids whose leaf cells reach into it
+    const Extractor extractor(interpolator,fieldID,isoValue,dim);
+    std::vector<std::vector<EmittedVertex>> emitted(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      range1f range;
+      for (uint64_t n=interpolator.neighborBegin[gridID];
+           n<interpolator.neighborBegin[gridID+1];n++) {
+        const range1f &neighborRange = ranges->of(interpolator.neighbors[n],dim);
+        if (!neighborRange.empty()) range.extend(neighborRange);
+      }
+      if (range.empty() || !(range.lower < isoValue && range.upper >= isoValue))
+        return;
+      extractor.extractGrid(gridID,emitted[gridID]);
+    },numThreads);
+
+    // merge vertices on the same edge: distribute them to buckets by
+    // their edge, and sort and de-duplicate each bucket
+    const size_t numChunks  = std::max<size_t>(1,std::min<size_t>(numGrids,256));
+    const size_t numBuckets = 256;
+    auto bucketOf = [&](const LatticeEdge &edge) { return hash(edge) % numBuckets; };
+    auto chunkBegin = [&](size_t chunkID) { return chunkID*numGrids/numChunks; };
+    std::vector<uint64_t> offsets(numBuckets*numChunks,0);
+    parallel_for(numChunks,[&](size_t chunkID) {
+      for (size_t gridID=chunkBegin(chunkID);gridID<chunkBegin(chunkID+1);gridID++)
+        for (auto &vertex : emitted[gridID])
+          offsets[bucketOf(vertex.edge)*numChunks+chunkID]++;
+    },numThreads);
+    std::vector<uint64_t> bucketBegin(numBuckets+1);
+    uint64_t numRefs = 0;
+    for (size_t bucketID=0;bucketID<numBuckets;bucketID++) {
+      bucketBegin[bucketID] = numRefs;
+      for (size_t chunkID=0;chunkID<numChunks;chunkID++) {
+        const uint64_t count = offsets[bucketID*numChunks+chunkID];
+        offsets[bucketID*numChunks+chunkID] = numRefs;
+        numRefs += count;
+      }
+    }
+    bucketBegin[numBuckets] = numRefs;
+
+    struct Entry {
+      LatticeEdge edge;
+      vec3f       position;
+      uint64_t    ref;
+    };
+    std::vector<uint64_t> refBegin(numGrids+1,0);
+    for (size_t gridID=0;gridID<numGrids;gridID++)
+      refBegin[gridID+1] = refBegin[gridID]+emitted[gridID].size();
+    std::vector<Entry> entries(numRefs);
+    parallel_for(numChunks,[&](size_t chunkID) {
+      for (size_t gridID=chunkBegin(chunkID);gridID<chunkBegin(chunkID+1);gridID++) {
+        for (size_t i=0;i<emitted[gridID].size();i++) {
+          const EmittedVertex &vertex = emitted[gridID][i];
+          entries[offsets[bucketOf(vertex.edge)*numChunks+chunkID]++]
+            = { vertex.edge, vertex.position, refBegin[gridID]+i };
+        }
+        std::vector<EmittedVertex>().swap(emitted[gridID]);
+      }
+    },numThreads);
+
+    std::vector<uint64_t> vertexBegin(numBuckets+1,0);
+    parallel_for(numBuckets,[&](size_t bucketID) {
+      std::sort(entries.begin()+bucketBegin[bucketID],entries.begin()+bucketBegin[bucketID+1],
+                [](const Entry &a, const Entry &b) { return a.edge < b.edge; });
+      uint64_t numUnique = 0;
+      for (uint64_t i=bucketBegin[bucketID];i<bucketBegin[bucketID+1];i++)
+        numUnique += (i == bucketBegin[bucketID] || !(entries[i].edge == entries[i-1].edge));
+      vertexBegin[bucketID+1] = numUnique;
+    },numThreads);
+    for (size_t bucketID=0;bucketID<numBuckets;bucketID++)
+      vertexBegin[bucketID+1] += vertexBegin[bucketID];
+    if (vertexBegin[numBuckets] >= (uint64_t)INT_MAX)
+      throw std::runtime_error("tamr::IsoSurface: too many vertices");
+
+    IsoSurface::SP result = std::make_shared<IsoSurface>();
+    result->vertices.resize(vertexBegin[numBuckets]);
+    std::vector<int32_t> vertexOfRef(numRefs);
+    parallel_for(numBuckets,[&](size_t bucketID) {
+      uint64_t vertexID = vertexBegin[bucketID];
+      for (uint64_t i=bucketBegin[bucketID];i<bucketBegin[bucketID+1];i++) {
+        if (i > bucketBegin[bucketID] && !(entries[i].edge == entries[i-1].edge))
+          vertexID++;
+        result->vertices[vertexID] = entries[i].position;
+        vertexOfRef[entries[i].ref] = (int32_t)vertexID;
+      }
+    },numThreads);
+
+    result->triangles.resize(numRefs/3);
+    for (size_t triangleID=0;triangleID<result->triangles.size();triangleID++)
+      result->triangles[triangleID] = vec3i(vertexOfRef[3*triangleID+0],
+                                            vertexOfRef[3*triangleID+1],
+                                            vertexOfRef[3*triangleID+2]);
+    return result;
+  }
+
+} // ::tamr
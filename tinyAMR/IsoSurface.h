@@ -0,0 +1,59 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Interpolator.h"
+#include "tinyAMR/ValueRanges.h"
+
+namespace tamr {
+
+  /*! a welded, world-space triangle mesh of where a field has a
+      given value, extracted directly from the AMR grids.
+
+      The field is the continuous reconstruction of Interpolator,
+      sampled at the corners of all leaf cells. Each leaf cell gets
+      split into tetrahedra - a pyramid from the cell's center to
+      each face, with each face fanned out from its center - and
+      where a face or edge borders finer cells, it gets split exactly
+      like the finer side splits it. So neighboring cells always
+      agree on their shared faces, whatever their levels, and the
+      surface has no cracks; it gets extracted with marching
+      tetrahedra. Vertices on the same mesh edge get merged, so the
+      mesh is watertight (except where it leaves the model).
+
+      Grids get processed in parallel, and grids whose values (and
+      those of all neighboring leaf cells) can't contain the iso
+      value get skipped without looking at any of their cells. This
+      assumes properly nested grids, ie, that finer grids start and
+      end on cell boundaries of the coarser ones. */
+  struct IsoSurface {
+    typedef std::shared_ptr<IsoSurface> SP;
+
+    /*! extracts the surface where given dimension of given field is
+        'isoValue'. Triangles are oriented such that their normals
+        point towards lower values. 'ranges' are the value ranges of
+        that field; if null, these get computed */
+    static SP extract(const Interpolator &interpolator,
+                      int fieldID, float isoValue, int dim = 0,
+                      const ValueRanges *ranges = nullptr,
+                      int numThreads = 0);
+
+    std::vector<vec3f> vertices;
+    std::vector<vec3i> triangles;
+  };
+
+} // ::tamr
@@ -0,0 +1,278 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/MacroCellGrid.h"
+#include "tinyAMR/FileFormat.h"
+#include "tinyAMR/parallel_for.h"
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <cstdio>
+#ifndef _WIN32
+# include <sys/stat.h>
+#endif
+
+namespace tamr {
+  using namespace tamr::format;
+
+  /*! magic number of macro cell grid files */
+  const uint64_t macroCellMagic = 0x665674465ABAD2ull;
+
+  /*! FNV-1a, over a few bytes at a time */
+  struct Fingerprint {
+    void add(const void *ptr, size_t numBytes)
+    {
+      for (size_t i=0;i<numBytes;i++)
+        hash = (hash ^ ((const uint8_t *)ptr)[i])*0x100000001b3ull;
+    }
+    template<typename T>
+    void add(const T &t) { add(&t,sizeof(t)); }
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+  };
+
+  inline void atomicMin(std::atomic<float> &a, float value)
+  {
+    float current = a.load();
+    while (value < current && !a.compare_exchange_weak(current,value));
+  }
+
+  inline void atomicMax(std::atomic<float> &a, float value)
+  {
+    float current = a.load();
+    while (value > current && !a.compare_exchange_weak(current,value));
+  }
+
+  vec3i MacroCellGrid::macroCellOf(const vec3f &worldPoint) const
+  {
+    const vec3f rel = (worldPoint-worldBounds.lower)/worldBounds.size()*vec3f(dims);
+    return max(vec3i(0),min(dims-vec3i(1),vec3i(int(floorf(rel.x)),
+                                                 int(floorf(rel.y)),
+                                                 int(floorf(rel.z)))));
+  }
+
+  MacroCellGrid::SP MacroCellGrid::build(const Model &model, int fieldID,
+                                         const vec3i &dims, int dim,
+                                         int numThreads)
+  {
+    const Model::FieldMeta &meta = model.fieldMetas.at(fieldID);
+    if (dim < 0 || dim >= meta.numDimensions)
+      throw std::runtime_error("tamr::MacroCellGrid: invalid field dimension");
+    if (dims.x < 1 || dims.y < 1 || dims.z < 1)
+      throw std::runtime_error("tamr::MacroCellGrid: invalid dims");
+
+    MacroCellGrid::SP mcg = std::make_shared<MacroCellGrid>();
+    mcg->fieldName = meta.name;
+    mcg->dim       = dim;
+    mcg->dims      = dims;
+    mcg->numGrids  = model.grids.size();
+    mcg->numCells  = model.numCellsAcrossAllGrids;
+    for (auto &grid : model.grids)
+      mcg->worldBounds.extend(model.worldBounds(grid));
+    const size_t numMacroCells = size_t(dims.x)*dims.y*dims.z;
+    mcg->ranges.assign(numMacroCells,range1f());
+    if (model.grids.empty()) return mcg;
+
+    std::vector<std::atomic<float>> lower(numMacroCells), upper(numMacroCells);
+    for (size_t i=0;i<numMacroCells;i++) {
+      lower[i].store(INFINITY);
+      upper[i].store(-INFINITY);
+    }
+    // maps world space to macro cell coordinates
+    const vec3f scale = vec3f(dims)/max(mcg->worldBounds.size(),vec3f(1e-20f));
+    auto macroCellRange = [&](const box3f &worldBox, vec3i &begin, vec3i &end) {
+      const vec3f lo = (worldBox.lower-mcg->worldBounds.lower)*scale;
+      const vec3f hi = (worldBox.upper-mcg->worldBounds.lower)*scale;
+      begin = max(vec3i(0),vec3i(int(floorf(lo.x)),int(floorf(lo.y)),int(floorf(lo.z))));
+      end   = min(dims,vec3i(int(floorf(hi.x)),int(floorf(hi.y)),int(floorf(hi.z)))+vec3i(1));
+    };
+
+    const float *fieldScalars
+      = model.scalars.data()+meta.offset+dim*model.numCellsAcrossAllGrids;
+    parallel_for(model.grids.size(),[&](size_t gridID) {
+      const Model::Grid &grid = model.grids[gridID];
+      const float width = model.cellWidth(grid.level);
+      // a cell's reach, ie, the cell grown by half a cell width
+      auto reachOf = [&](const vec3i &cell) {
+        return model.toWorld(box3f((vec3f(grid.origin+cell)-vec3f(.5f))*width,
+                                   (vec3f(grid.origin+cell)+vec3f(1.5f))*width));
+      };
+
+      // gather this grid's ranges locally first, so there's only one
+      // atomic update per grid and macro cell
+      vec3i gridBegin, gridEnd;
+      const box3f gridReach = reachOf(vec3i(0)).including(reachOf(grid.dims-vec3i(1)));
+      macroCellRange(gridReach,gridBegin,gridEnd);
+      const vec3i localDims = max(vec3i(0),gridEnd-gridBegin);
+      std::vector<range1f> local(size_t(localDims.x)*localDims.y*localDims.z);
+
+      for (int iz=0;iz<grid.dims.z;iz++)
+        for (int iy=0;iy<grid.dims.y;iy++)
+          for (int ix=0;ix<grid.dims.x;ix++) {
+            const vec3i cell(ix,iy,iz);
+            const float value = fieldScalars[grid.offset+model.cellIndex(grid,cell)];
+            if (std::isnan(value)) continue;
+            vec3i begin, end;
+            macroCellRange(reachOf(cell),begin,end);
+            for (int mz=begin.z;mz<end.z;mz++)
+              for (int my=begin.y;my<end.y;my++)
+                for (int mx=begin.x;mx<end.x;mx++) {
+                  const vec3i m = vec3i(mx,my,mz)-gridBegin;
+                  local[m.x+size_t(localDims.x)*(m.y+size_t(localDims.y)*m.z)].extend(value);
+                }
+          }
+
+      for (int mz=0;mz<localDims.z;mz++)
+        for (int my=0;my<localDims.y;my++)
+          for (int mx=0;mx<localDims.x;mx++) {
+            const range1f &range = local[mx+size_t(localDims.x)*(my+size_t(localDims.y)*mz)];
+            if (range.empty()) continue;
+            const vec3i m = gridBegin+vec3i(mx,my,mz);
+            const size_t idx = m.x+size_t(dims.x)*(m.y+size_t(dims.y)*m.z);
+            atomicMin(lower[idx],range.lower);
+            atomicMax(upper[idx],range.upper);
+          }
+    },numThreads);
+
+    for (size_t i=0;i<numMacroCells;i++)
+      if (lower[i].load() <= upper[i].load())
+        mcg->ranges[i] = range1f(lower[i].load(),upper[i].load());
+    return mcg;
+  }
+
+  void MacroCellGrid::save(const std::string &fileName) const
+  {
+    std::ofstream out(fileName,std::ios::binary);
+    write(out,macroCellMagic);
+    writeString(out,fieldName);
+    write(out,dim);
+    write(out,worldBounds);
+    write(out,dims);
+    write(out,numGrids);
+    write(out,numCells);
+    write(out,sourceFingerprint);
+    write(out,ranges.size());
+    out.write((const char *)ranges.data(),ranges.size()*sizeof(range1f));
+    if (!out.good())
+      throw std::runtime_error("tamr::MacroCellGrid: error writing '"+fileName+"'");
+  }
+
+  MacroCellGrid::SP MacroCellGrid::load(const std::string &fileName)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    if (!in.good())
+      throw std::runtime_error("tamr::MacroCellGrid: could not open '"+fileName+"'");
+    if (read<uint64_t>(in) != macroCellMagic)
+      throw std::runtime_error("tamr::MacroCellGrid: '"+fileName
+                               +"' is not a macro cell grid file");
+    MacroCellGrid::SP mcg = std::make_shared<MacroCellGrid>();
+    mcg->fieldName   = readString(in);
+    mcg->dim         = read<int>(in);
+    mcg->worldBounds = read<box3f>(in);
+    mcg->dims        = read<vec3i>(in);
+    mcg->numGrids    = read<uint64_t>(in);
+    mcg->numCells    = read<uint64_t>(in);
+    mcg->sourceFingerprint = read<uint64_t>(in);
+    readVector(in,mcg->ranges);
+    if (!in.good() ||
+        mcg->ranges.size() != size_t(mcg->dims.x)*mcg->dims.y*mcg->dims.z)
+      throw std::runtime_error("tamr::MacroCellGrid: error reading '"+fileName+"'");
+    return mcg;
+  }
+
+  std::string MacroCellGrid::sideFileName(const std::string &tamrFileName,
+                                          const std::string &fieldName, int dim)
+  {
+    std::string name = fieldName;
+    bool renamed = false;
+    for (char &c : name)
+      if (!isalnum((unsigned char)c) && c != '-' && c != '_') {
+        c = '_';
+        renamed = true;
+      }
+    if (renamed) {
+      Fingerprint original;
+      original.add(fieldName.data(),fieldName.size());
+      char hex[20];
+      snprintf(hex,sizeof(hex),"-%08x",(uint32_t)(original.hash ^ (original.hash >> 32)));
+      name += hex;
+    }
+    return tamrFileName+"."+name
+      +(dim ? "."+std::to_string(dim) : std::string())+".mcg";
+  }
+
+  uint64_t MacroCellGrid::fingerprint(const std::string &tamrFileName, const Model &model)
+  {
+    Fingerprint fingerprint;
+#ifdef _WIN32
+    std::ifstream in(tamrFileName,std::ios::binary|std::ios::ate);
+    fingerprint.add((uint64_t)in.tellg());
+#else
+    struct stat st;
+    if (stat(tamrFileName.c_str(),&st) == 0) {
+      fingerprint.add((uint64_t)st.st_size);
+      fingerprint.add((int64_t)st.st_mtim.tv_sec);
+      fingerprint.add((int64_t)st.st_mtim.tv_nsec);
+    }
+#endif
+    for (int refinement : model.refinementOfLevel)
+      fingerprint.add(refinement);
+    fingerprint.add(model.gridOrigin);
+    fingerprint.add(model.gridOffset);
+    fingerprint.add(model.cellLayout);
+    for (auto &grid : model.grids) {
+      fingerprint.add(grid.origin);
+      fingerprint.add(grid.dims);
+      fingerprint.add(grid.level);
+      fingerprint.add(grid.offset);
+    }
+    return fingerprint.hash;
+  }
+
+  MacroCellGrid::SP MacroCellGrid::loadOrBuild(const std::string &tamrFileName,
+                                               const Model &model,
+                                               int fieldID, const vec3i &dims,
+                                               int dim)
+  {
+    const std::string &fieldName = model.fieldMetas.at(fieldID).name;
+    const std::string fileName = sideFileName(tamrFileName,fieldName,dim);
+    const uint64_t sourceFingerprint = fingerprint(tamrFileName,model);
+    box3f worldBounds;
+    for (auto &grid : model.grids)
+      worldBounds.extend(model.worldBounds(grid));
+    try {
+      MacroCellGrid::SP mcg = load(fileName);
+      if (mcg->fieldName == fieldName && mcg->dim == dim && mcg->dims == dims &&
+          mcg->numGrids == model.grids.size() &&
+          mcg->numCells == model.numCellsAcrossAllGrids &&
+          mcg->sourceFingerprint == sourceFingerprint &&
+          mcg->worldBounds.lower == worldBounds.lower &&
+          mcg->worldBounds.upper == worldBounds.upper)
+        return mcg;
+    } catch (const std::exception &) {
+      // no (valid) side file; build one
+    }
+    MacroCellGrid::SP mcg = build(model,fieldID,dims,dim);
+    mcg->sourceFingerprint = sourceFingerprint;
+    try {
+      mcg->save(fileName);
+    } catch (const std::exception &) {
+      // not being able to cache it is not an error
+    }
+    return mcg;
+  }
+
+} // ::tamr
@@ -0,0 +1,95 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Model.h"
+
+namespace tamr {
+
+  /*! a coarse, uniform grid of 'macro cells' over the world-space
+      bounds of a model, storing for each macro cell the range of
+      values that one field takes on within it - as needed for
+      empty-space skipping, or as majorants for delta tracking.
+      Every cell contributes to all macro cells that its value can
+      reach when interpolated, ie, that overlap the cell grown by half
+      a cell width on each side; so the ranges are conservative for
+      nearest, trilinear and basis-function (see Interpolator)
+      reconstruction alike. NaN values are ignored; macro cells that
+      no cell reaches have an empty range. */
+  struct MacroCellGrid {
+    typedef std::shared_ptr<MacroCellGrid> SP;
+
+    /*! builds a grid of 'dims' macro cells over the given dimension
+        of the given field of the given model, with grids getting
+        rasterized in parallel */
+    static SP build(const Model &model, int fieldID, const vec3i &dims,
+                    int dim = 0, int numThreads = 0);
+
+    /*! loads a macro cell grid that was saved with save() */
+    static SP load(const std::string &fileName);
+
+    void save(const std::string &fileName) const;
+
+    /*! name of the file that loadOrBuild() keeps the macro cells of
+        the given field of the given .tamr file in; characters of the
+        field name that don't belong into a file name (such as the
+        '/' in exa's field names) get replaced, with a hash of the
+        original name added to keep such names apart */
+    static std::string sideFileName(const std::string &tamrFileName,
+                                    const std::string &fieldName, int dim = 0);
+
+    /*! loads the macro cells of given field of the model that was
+        loaded from 'tamrFileName' from its side file if that exists
+        and matches (dims, model, and the .tamr file's fingerprint);
+        otherwise builds them, and tries to save them to the side file
+        for next time */
+    static SP loadOrBuild(const std::string &tamrFileName, const Model &model,
+                          int fieldID, const vec3i &dims, int dim = 0);
+
+    /*! fingerprint of the given .tamr file and the model loaded from
+        it - the file's size and modification time, and the model's
+        grids and how they map to world space - so a side file that
+        was built for an older version of that file can be told
+        apart */
+    static uint64_t fingerprint(const std::string &tamrFileName, const Model &model);
+
+    /*! value range of given macro cell */
+    const range1f &range(const vec3i &macroCell) const
+    { return ranges[macroCell.x+size_t(dims.x)*(macroCell.y+size_t(dims.y)*macroCell.z)]; }
+
+    /*! the macro cell that given world-space point is in, clamped to
+        the grid */
+    vec3i macroCellOf(const vec3f &worldPoint) const;
+
+    /*! name and dimension of the field this was built for */
+    std::string          fieldName;
+    int                  dim = 0;
+    /*! world-space region that the macro cells subdivide */
+    box3f                worldBounds;
+    vec3i                dims;
+    /*! one range per macro cell, x fastest, then y, then z */
+    std::vector<range1f> ranges;
+    /*! number of grids and cells of the model this was built for;
+        only used to check that a side file matches its model */
+    uint64_t             numGrids = 0;
+    uint64_t             numCells = 0;
+    /*! fingerprint() of the .tamr file this was built for, if built
+        by loadOrBuild(); else 0 */
+    uint64_t             sourceFingerprint = 0;
+  };
+
+} // ::tamr
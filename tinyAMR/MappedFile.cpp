@@ -0,0 +1,63 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/MappedFile.h"
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace tamr {
+
+  MappedFile::SP MappedFile::open(const std::string &fileName)
+  {
+#ifdef _WIN32
+    throw std::runtime_error("tamr::MappedFile: memory mapping not supported on windows");
+#else
+    int fd = ::open(fileName.c_str(),O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("tamr::MappedFile: could not open '"+fileName+"'");
+    struct stat st;
+    if (fstat(fd,&st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("tamr::MappedFile: could not stat '"+fileName+"'");
+    }
+    MappedFile::SP file = std::make_shared<MappedFile>();
+    file->size = st.st_size;
+    if (file->size > 0) {
+      void *mem = mmap(nullptr,file->size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+      if (mem == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("tamr::MappedFile: could not map '"+fileName+"'");
+      }
+      file->begin = (uint8_t *)mem;
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return file;
+#endif
+  }
+
+  MappedFile::~MappedFile()
+  {
+#ifndef _WIN32
+    if (begin) munmap(begin,size);
+#endif
+  }
+
+} // ::tamr
@@ -0,0 +1,42 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/common.h"
+#include <memory>
+
+namespace tamr {
+
+  /*! a private (ie, copy-on-write) memory mapping of an entire
+      file. Pages only get read from disk once they are first
+      touched; writes to the mapped memory are allowed, but will
+      never make it back into the file. */
+  struct MappedFile {
+    typedef std::shared_ptr<MappedFile> SP;
+
+    /*! map given file; throws a std::runtime_error if that fails */
+    static MappedFile::SP open(const std::string &fileName);
+
+    ~MappedFile();
+
+    /*! pointer to first byte of the file */
+    uint8_t *begin = nullptr;
+    /*! size of file, in bytes */
+    size_t   size  = 0;
+  };
+
+} // ::tamr
@@ -15,91 +15,411 @@
 // ======================================================================== //
 
 #include "tinyAMR/Model.h"
+#include "tinyAMR/FileFormat.h"
+#include "tinyAMR/MappedFile.h"
+#include "tinyAMR/ParallelIO.h"
+#include "tinyAMR/Compression.h"
+#include "tinyAMR/SpaceFillingCurve.h"
+#include "tinyAMR/ValueRanges.h"
+#include "tinyAMR/GridAdjacency.h"
+#include "tinyAMR/parallel_for.h"
 #include <fstream>
+#include <algorithm>
+#include <chrono>
 
 namespace tamr {
-  const size_t magic = 0x665674465ABABull;
+  using namespace tamr::format;
 
-  template<typename T> void write(std::ostream &out, const T &scalar)
-  { out.write((char*)&scalar,sizeof(scalar)); }
-
-  template<typename T> T read(std::istream &in)
-  { T scalar; in.read((char*)&scalar,sizeof(scalar)); return scalar; }
+  /*! makes 'array' a view into the mapped file if the given (raw)
+      section is properly aligned within that file; otherwise reads
+      it the usual way */
+  template<typename T>
+  void mapSection(std::istream &in, const Section &section,
+                  MappedFile::SP file, Array<T> &array)
+  {
+    if (section.encoding != ENCODING_RAW ||
+        section.offset % alignof(T) ||
+        section.size != section.count*sizeof(T)) {
+      readSection(in,section,array);
+      return;
+    }
+    if (section.offset + section.size > file->size)
+      throw std::runtime_error("tamr: truncated file");
+    array = Array<T>::view((T*)(file->begin+section.offset),section.count,file);
+  }
   
-  void writeString(std::ostream &out, const std::string &s)
+  float Model::cellWidth(int level) const
   {
-    write(out,(int)s.size());
-    out.write((char*)s.c_str(),s.size());
+    return 1.f/refinementOfLevel[level];
   }
-
-  std::string readString(std::istream &in)
+    
+  box3f Model::toWorld(const box3f &logical) const
+  {
+    return box3f(gridOrigin+logical.lower*gridOffset,
+                 gridOrigin+logical.upper*gridOffset);
+  }
+    
+  box3f Model::logicalBounds(const Grid &grid) const
   {
-    std::vector<char> chars(read<int>(in));
-    in.read((char*)chars.data(),chars.size());
-    chars.push_back(0);
-    return chars.data();
+    const float width = cellWidth(grid.level);
+    return box3f(vec3f(grid.origin)*width,
+                 vec3f(grid.origin+grid.dims)*width);
+  }
+    
+  box3f Model::worldBounds(const Grid &grid) const
+  {
+    return toWorld(logicalBounds(grid));
   }
 
-  template<typename T>
-  void writeVector(std::ostream &out, const std::vector<T> &vec)
+  void Model::setCellLayout(CellLayout layout, int numThreads)
   {
-    write(out,vec.size());
-    out.write((char*)vec.data(),vec.size()*sizeof(T));
+    if (layout == cellLayout) return;
+    std::vector<uint64_t> streamBase;
+    for (auto &meta : fieldMetas)
+      for (int dim=0;dim<meta.numDimensions;dim++)
+        streamBase.push_back(meta.offset+dim*numCellsAcrossAllGrids);
+    parallel_for(grids.size(),[&](size_t gridID) {
+      const Grid &grid = grids[gridID];
+      const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+      // where each cell moves to
+      std::vector<uint64_t> from(numCells);
+      for (int iz=0;iz<grid.dims.z;iz++)
+        for (int iy=0;iy<grid.dims.y;iy++)
+          for (int ix=0;ix<grid.dims.x;ix++) {
+            const vec3i cell(ix,iy,iz);
+            from[tamr::cellIndex(layout,grid.dims,cell)]
+              = tamr::cellIndex(cellLayout,grid.dims,cell);
+          }
+      std::vector<float> tmp(numCells);
+      for (uint64_t base : streamBase) {
+        float *values = scalars.data()+base+grid.offset;
+        if (base+grid.offset+numCells > scalars.size())
+          throw std::runtime_error("tamr: grid exceeds the model's scalars");
+        for (uint64_t i=0;i<numCells;i++)
+          tmp[i] = values[from[i]];
+        std::copy(tmp.begin(),tmp.end(),values);
+      }
+    },numThreads);
+    cellLayout = layout;
   }
-  
-  template<typename T>
-  void readVector(std::istream &in, std::vector<T> &vec)
+
+  void Model::reorderGrids(GridOrder order, bool groupByLevel, int numThreads)
   {
-    vec.resize(read<size_t>(in));
-    in.read((char*)vec.data(),vec.size()*sizeof(T));
+    if (order == GRID_ORDER_AS_IS && !groupByLevel) return;
+    const size_t numGrids = grids.size();
+    
+    // curve position of each grid's center, with the centers' bounds
+    // quantized to 21 bits per axis
+    box3f bounds;
+    for (auto &grid : grids)
+      bounds.extend(logicalBounds(grid).center());
+    const vec3f scale = vec3f(float((1<<21)-1))/max(bounds.size(),vec3f(1e-20f));
+    std::vector<std::pair<uint64_t,size_t>> keys(numGrids);
+    parallel_for(numGrids,[&](size_t gridID) {
+      const Grid &grid = grids[gridID];
+      const vec3f p = (logicalBounds(grid).center()-bounds.lower)*scale;
+      const uint32_t x = (uint32_t)p.x, y = (uint32_t)p.y, z = (uint32_t)p.z;
+      uint64_t key = 0;
+      if (order == GRID_ORDER_MORTON)  key = mortonCode3(x,y,z);
+      if (order == GRID_ORDER_HILBERT) key = hilbertCode3(x,y,z);
+      keys[gridID] = { key, gridID };
+    },numThreads);
+    if (groupByLevel)
+      std::stable_sort(keys.begin(),keys.end(),
+                       [&](const std::pair<uint64_t,size_t> &a,
+                           const std::pair<uint64_t,size_t> &b) {
+                         const int la = grids[a.second].level;
+                         const int lb = grids[b.second].level;
+                         return la < lb || (la == lb && a.first < b.first);
+                       });
+    else
+      std::stable_sort(keys.begin(),keys.end());
+
+    std::vector<Grid> newGrids(numGrids);
+    uint64_t numCells = 0;
+    for (size_t i=0;i<numGrids;i++) {
+      newGrids[i] = grids[keys[i].second];
+      newGrids[i].offset = numCells;
+      numCells += uint64_t(newGrids[i].dims.x)*newGrids[i].dims.y*newGrids[i].dims.z;
+    }
+    if (numCells > numCellsAcrossAllGrids)
+      throw std::runtime_error("tamr: can't reorder grids that share scalars");
+
+    // move each grid's scalars, in each dimension of each field
+    std::vector<uint64_t> streamBase;
+    for (auto &meta : fieldMetas)
+      for (int dim=0;dim<meta.numDimensions;dim++)
+        streamBase.push_back(meta.offset+dim*numCellsAcrossAllGrids);
+    std::vector<float> newScalars(scalars.size(),0.f);
+    parallel_for(numGrids,[&](size_t i) {
+      const Grid &oldGrid = grids[keys[i].second];
+      const uint64_t count = uint64_t(oldGrid.dims.x)*oldGrid.dims.y*oldGrid.dims.z;
+      for (uint64_t base : streamBase) {
+        if (base+oldGrid.offset+count > scalars.size())
+          throw std::runtime_error("tamr: grid exceeds the model's scalars");
+        std::copy(scalars.data()+base+oldGrid.offset,
+                  scalars.data()+base+oldGrid.offset+count,
+                  newScalars.data()+base+newGrids[i].offset);
+      }
+    },numThreads);
+
+    grids   = Array<Grid>(std::move(newGrids));
+    scalars = Array<float>(std::move(newScalars));
   }
   
   void Model::save(const std::string &fileName) const
   {
     std::ofstream out(fileName,std::ios::binary);
-    out.write((char *)&magic,sizeof(magic));
-
-    writeVector(out,refinementOfLevel);
-    writeVector(out,scalars);
-    writeVector(out,grids);
-    write(out,numCellsAcrossAllGrids);
-    write(out,(int)fieldMetas.size());
-    for (auto &meta : fieldMetas) {
-      writeString(out,meta.name);
-      write(out,meta.numDimensions);
-      write(out,meta.offset);
-      writeString(out,meta.info);
+    if (!out.good())
+      throw std::runtime_error("tamr: could not open '"+fileName+"' for writing");
+    FilePlan plan = planFile(*this);
+    plan.layOut();
+    plan.write(out);
+  }
+
+  /*! reads a model from given stream; if 'mapped' is non-null that
+      must be a mapping of the same file, and scalars and grids will
+      be views into that mapping rather than get read */
+  static Model::SP readModel(std::istream &in, MappedFile::SP mapped)
+  {
+    Layout layout = readLayout(in);
+    Model::SP model = readMetaData(in,layout);
+    if (mapped) {
+      mapSection(in,layout.get(SECTION_SCALARS),mapped,model->scalars);
+      mapSection(in,layout.get(SECTION_GRIDS),mapped,model->grids);
+    } else {
+      readSection(in,layout.get(SECTION_SCALARS),model->scalars);
+      readSection(in,layout.get(SECTION_GRIDS),model->grids);
     }
-    writeString(out,userMeta);
-    write(out,this->gridOrigin);
-    write(out,this->gridOffset);
+    if (!in.good())
+      throw std::runtime_error("tamr: error reading file");
+    return model;
   }
 
   Model::SP Model::load(const std::string &fileName)
   {
-    Model::SP model = std::make_shared<Model>();
     std::ifstream in(fileName,std::ios::binary);
+    return readModel(in,nullptr);
+  }
 
-    size_t magic;
-    in.read((char *)&magic,sizeof(magic));
-    if (magic != tamr::magic) throw std::runtime_error("wrong magic number");
+  static double now()
+  {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+  }
 
-    readVector(in,model->refinementOfLevel);
-    readVector(in,model->scalars);
-    readVector(in,model->grids);
-    model->numCellsAcrossAllGrids = read<size_t>(in);
-    model->fieldMetas.resize(read<int>(in));
-    for (auto &meta : model->fieldMetas) {
-      meta.name = readString(in);
-      meta.numDimensions = read<int>(in);
-      meta.offset = read<uint64_t>(in);
-      meta.info = readString(in);
+  void Model::save(const std::string &fileName,
+                   const IOOptions &options,
+                   IOStats *stats) const
+  {
+    if (options.gridOrder != GRID_ORDER_AS_IS || options.groupGridsByLevel) {
+      Model reordered = *this;
+      reordered.reorderGrids(options.gridOrder,options.groupGridsByLevel,
+                             options.numThreads);
+      IOOptions asIs = options;
+      asIs.gridOrder         = GRID_ORDER_AS_IS;
+      asIs.groupGridsByLevel = false;
+      reordered.save(fileName,asIs,stats);
+      return;
+    }
+    
+    const double t0 = now();
+    FilePlan plan = planFile(*this);
+    if (options.storeValueRanges)
+      addValueRanges(plan,*this,options);
+    if (options.storeGridAdjacency)
+      addGridAdjacency(plan,*this,options);
+    if (options.compression == IOOptions::COMPRESSION_LOSSLESS)
+      for (auto &pending : plan.sections)
+        if (pending.section.type == SECTION_SCALARS)
+          compressScalars(pending,options.numThreads);
+    if (options.compression == IOOptions::COMPRESSION_LOSSY)
+      compressScalarsLossy(plan,*this,options);
+    const uint64_t fileSize = plan.layOut();
+
+    std::string toc((const char *)&plan.header,sizeof(plan.header));
+    for (auto &pending : plan.sections)
+      toc.append((const char *)&pending.section,sizeof(Section));
+    std::vector<IORequest> requests = {{ (void*)toc.data(),toc.size(),0 }};
+    for (auto &pending : plan.sections) {
+      const Section &section = pending.section;
+      if (section.type == SECTION_FIELD_SCALARS) continue;
+      if (!pending.bytes.empty())
+        requests.push_back({(void*)pending.bytes.data(),pending.bytes.size(),
+                            section.offset});
+      for (auto &piece : pending.pieces)
+        requests.push_back({(void*)piece.data,piece.size,
+                            section.offset+piece.offset});
+    }
+    writeParallel(fileName,fileSize,requests,options);
+
+    if (stats) {
+      stats->numBytes = 0;
+      for (auto &request : requests)
+        stats->numBytes += request.size;
+      stats->seconds = now()-t0;
+    }
+  }
+
+  Model::SP Model::load(const std::string &fileName,
+                        const IOOptions &options,
+                        IOStats *stats)
+  {
+    const double t0 = now();
+    std::ifstream in(fileName,std::ios::binary);
+    if (!in.good())
+      throw std::runtime_error("tamr: could not open '"+fileName+"'");
+    Layout layout = readLayout(in);
+    Model::SP model = readMetaData(in,layout);
+    if (!in.good())
+      throw std::runtime_error("tamr: error reading file");
+    in.close();
+
+    std::vector<IORequest> requests;
+    auto addSection = [&](const Section &section, auto &array) {
+      typedef typename std::decay<decltype(array)>::type::value_type T;
+      if (section.encoding != ENCODING_RAW)
+        throw std::runtime_error("tamr: unsupported section encoding");
+      if (section.size != section.count*sizeof(T))
+        throw std::runtime_error("tamr: inconsistent section size");
+      array.resize(section.count);
+      requests.push_back({(void*)array.data(),section.size,section.offset});
+    };
+    // compressed scalars get read as they are, and decoded after
+    const Section &scalars = layout.get(SECTION_SCALARS);
+    std::vector<uint8_t> encoded;
+    if (scalars.encoding != ENCODING_RAW) {
+      encoded.resize(scalars.size);
+      requests.push_back({(void*)encoded.data(),scalars.size,scalars.offset});
+    } else
+      addSection(scalars,model->scalars);
+    addSection(layout.get(SECTION_GRIDS),model->grids);
+    readParallel(fileName,requests,options);
+    if (!encoded.empty()) {
+      model->scalars.resize(scalars.count);
+      decodeScalars(scalars,encoded.data(),model->scalars.data(),options.numThreads);
+    }
+
+    if (stats) {
+      stats->numBytes = 0;
+      for (auto &request : requests)
+        stats->numBytes += request.size;
+      stats->seconds = now()-t0;
     }
-    model->userMeta = readString(in);
-    model->gridOrigin = read<vec3f>(in);
-    model->gridOffset = read<vec3f>(in);
+    return model;
+  }
+
+  Model::SP Model::loadMapped(const std::string &fileName)
+  {
+    MappedFile::SP mapped = MappedFile::open(fileName);
+    std::ifstream in(fileName,std::ios::binary);
+    return readModel(in,mapped);
+  }
+
+  Model::SP Model::load(const std::string &fileName,
+                        const std::vector<std::string> &fieldNames)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    Layout layout = readLayout(in);
+    Model::SP model = readMetaData(in,layout);
+    readSection(in,layout.get(SECTION_GRIDS),model->grids);
+
+    std::vector<FieldMeta> allFields = model->fieldMetas;
+    model->fieldMetas.clear();
+    ScalarReader scalars(in,layout.get(SECTION_SCALARS));
+    for (auto &name : fieldNames) {
+      int fieldID = -1;
+      for (int i=0;i<(int)allFields.size();i++)
+        if (allFields[i].name == name) { fieldID = i; break; }
+      if (fieldID < 0)
+        throw std::runtime_error("tamr: file '"+fileName
+                                 +"' does not contain a field named '"+name+"'");
+      const Section &range = layout.get(SECTION_FIELD_SCALARS,fieldID);
+
+      FieldMeta meta = allFields[fieldID];
+      meta.offset = model->scalars.size();
+      model->fieldMetas.push_back(meta);
+      model->scalars.resize(meta.offset+range.count);
+      scalars.read(range.begin,range.count,model->scalars.data()+meta.offset);
+    }
+    if (!in.good())
+      throw std::runtime_error("tamr: error reading file");
+    return model;
+  }
+
+  Model::SP Model::load(const std::string &fileName,
+                        const box3f &worldRegion,
+                        int minLevel, int maxLevel)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    Layout layout = readLayout(in);
+    Model::SP model = readMetaData(in,layout);
+    ScalarReader scalars(in,layout.get(SECTION_SCALARS));
+    
+    Array<Grid> allGrids;
+    readSection(in,layout.get(SECTION_GRIDS),allGrids);
+    std::vector<Grid> selected;
+    for (auto &grid : allGrids)
+      if (grid.level >= minLevel && grid.level <= maxLevel &&
+          model->worldBounds(grid).overlaps(worldRegion))
+        selected.push_back(grid);
     
+    // assign new offsets in order of the old ones, so that grids
+    // that are adjacent in the file can get read in one go
+    std::vector<size_t> order(selected.size());
+    for (size_t i=0;i<order.size();i++) order[i] = i;
+    std::sort(order.begin(),order.end(),[&](size_t a, size_t b)
+    { return selected[a].offset < selected[b].offset; });
+    std::vector<uint64_t> oldOffsets(selected.size());
+    uint64_t numCells = 0;
+    for (auto i : order) {
+      Grid &grid = selected[i];
+      oldOffsets[i] = grid.offset;
+      grid.offset = numCells;
+      numCells += uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+    }
+
+    const uint64_t oldNumCells = model->numCellsAcrossAllGrids;
+    model->numCellsAcrossAllGrids = numCells;
+    model->grids = selected;
+    for (auto &meta : model->fieldMetas) {
+      const uint64_t oldFieldOffset = meta.offset;
+      meta.offset = model->scalars.size();
+      model->scalars.resize(meta.offset+meta.numDimensions*numCells);
+      for (int dim=0;dim<meta.numDimensions;dim++) {
+        const uint64_t srcBase = oldFieldOffset + dim*oldNumCells;
+        float *dst = model->scalars.data() + meta.offset + dim*numCells;
+        // read runs of grids that are contiguous in the file
+        for (size_t i=0;i<order.size();) {
+          const uint64_t runBegin = oldOffsets[order[i]];
+          const uint64_t dstBegin = selected[order[i]].offset;
+          uint64_t runEnd = runBegin;
+          for (;i<order.size() && oldOffsets[order[i]] == runEnd;i++) {
+            const vec3i dims = selected[order[i]].dims;
+            runEnd += uint64_t(dims.x)*dims.y*dims.z;
+          }
+          scalars.read(srcBase+runBegin,runEnd-runBegin,dst+dstBegin);
+        }
+      }
+    }
+    if (!in.good())
+      throw std::runtime_error("tamr: error reading file");
     return model;
   }
+  
+  Model::SP Model::load(const std::string &fileName,
+                        const box3i &cellRegion, int regionLevel,
+                        int minLevel, int maxLevel)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    Layout layout = readLayout(in);
+    Model::SP meta = readMetaData(in,layout);
+    if (regionLevel < 0 || regionLevel >= (int)meta->refinementOfLevel.size())
+      throw std::runtime_error("tamr: invalid region level");
+    const float width = meta->cellWidth(regionLevel);
+    box3f logical(vec3f(cellRegion.lower)*width,
+                  vec3f(cellRegion.upper+vec3i(1))*width);
+    return load(fileName,meta->toWorld(logical),minLevel,maxLevel);
+  }
 
 } // ::tinyAMR
@@ -17,11 +17,83 @@
 #pragma once
 
 #include "tinyAMR/common.h"
+#include "tinyAMR/Array.h"
+#include "tinyAMR/CellLayout.h"
 #include <vector>
 #include <memory>
+#include <map>
 
 namespace tamr {
 
+  /*! order to put a model's grids in; see Model::reorderGrids() */
+  typedef enum {
+    GRID_ORDER_AS_IS, GRID_ORDER_MORTON, GRID_ORDER_HILBERT
+  } GridOrder;
+
+  /*! options for the parallel variants of Model::save/load */
+  struct IOOptions {
+    /*! number of threads issuing reads/writes; 0 means one per
+        hardware thread */
+    int      numThreads = 0;
+    /*! large sections get split into chunks of (at most) this many
+        bytes, each of which gets read/written independently */
+    uint64_t chunkSize  = 8ull<<20;
+
+    typedef enum {
+      COMPRESSION_NONE, COMPRESSION_LOSSLESS, COMPRESSION_LOSSY
+    } Compression;
+    /*! how to store the scalars when saving; compressed files can be
+        read by all loaders, see Compression.h */
+    Compression compression = COMPRESSION_NONE;
+
+    struct ErrorBound {
+      /*! max (absolute) difference between any original scalar and
+          what it decompresses to ... */
+      float value    = 0.f;
+      /*! ... or, if true, that max difference relative to the
+          field's range of values */
+      bool  relative = false;
+    };
+    /*! for COMPRESSION_LOSSY: error bound per field (by field name);
+        fields without an entry get stored lossless */
+    std::map<std::string,ErrorBound> errorBounds;
+
+    /*! reduced-precision formats a field can be stored in; same as
+        QuantizedField::Format */
+    typedef enum {
+      QUANTIZE_FP16, QUANTIZE_BF16, QUANTIZE_UNORM8, QUANTIZE_UNORM16
+    } Quantization;
+    /*! for COMPRESSION_LOSSY: fields (by field name) whose scalars
+        get stored in reduced precision, one chunk per grid (with the
+        unorm formats mapped to that grid's range of values); these
+        take precedence over errorBounds */
+    std::map<std::string,Quantization> quantizedFields;
+
+    /*! if not GRID_ORDER_AS_IS, the file gets written with its grids
+        (and their scalars) reordered along that curve; the model
+        itself does not change, see Model::reorderGrids() */
+    GridOrder gridOrder         = GRID_ORDER_AS_IS;
+    /*! for gridOrder: whether to store grids level by level */
+    bool      groupGridsByLevel = false;
+
+    /*! whether to also store each grid's range of values of each
+        field; see ValueRanges.h */
+    bool      storeValueRanges  = false;
+    /*! whether to also store which grids neighbor which; see
+        GridAdjacency.h */
+    bool      storeGridAdjacency = false;
+  };
+
+  /*! what a parallel save/load achieved */
+  struct IOStats {
+    double gbPerSecond() const { return seconds > 0. ? numBytes/seconds/1e9 : 0.; }
+    
+    /*! bytes actually read or written */
+    uint64_t numBytes = 0;
+    /*! wall-clock time of the entire save/load */
+    double   seconds  = 0.;
+  };
+
   struct Model {
     typedef std::shared_ptr<Model> SP;
     
@@ -34,7 +106,8 @@ namespace tamr {
       
       /*! dimensions of this grid's 3D array of cells. The Nx*Ny*Nz
           scalars for this grid iwill be stored at
-          scalars[grid.offset] in z-major order */
+          scalars[grid.offset], in z-major order unless the model's
+          cellLayout says otherwise */
       vec3i    dims;
       
       /*! level of this grid, *relative to Model::refinementLevel* --
@@ -78,20 +151,104 @@ namespace tamr {
       std::string info = "<undefined>";
     };
 
+    /*! saves this model in the (current) v2 .tamr format; see
+        FileFormat.h */
     void save(const std::string &fileName) const;
     
+    /*! loads a model from either a v2 or an (old) v1 .tamr file */
     static Model::SP load(const std::string &fileName);
+
+    /*! same as save(), but writes all sections concurrently, in
+        chunks, with positional writes from multiple threads; if
+        'stats' is non-null it gets filled in with the number of
+        bytes written and the time that took */
+    void save(const std::string &fileName,
+              const IOOptions &options,
+              IOStats *stats = nullptr) const;
+
+    /*! same as load(), but reads the scalars and grids concurrently,
+        in chunks, with positional reads from multiple threads */
+    static Model::SP load(const std::string &fileName,
+                          const IOOptions &options,
+                          IOStats *stats = nullptr);
+
+    /*! same as load(), but rather than reading the file's scalars
+        and grids into memory this maps the file into memory and
+        returns a model whose 'scalars' and 'grids' are views into
+        that mapping; pages get read from disk only once (and if) they
+        get touched. The mapping is private, so modifying the model
+        will never change the file. */
+    static Model::SP loadMapped(const std::string &fileName);
+
+    /*! loads only the given fields (and all grids) from the given
+        file, skipping over all other fields' scalars. The returned
+        model's fieldMetas are in the order the fields were
+        requested in, with their offsets remapped to where their
+        scalars now are. Throws an error if any of these fields does
+        not exist in the file. */
+    static Model::SP load(const std::string &fileName,
+                          const std::vector<std::string> &fieldNames);
+
+    /*! loads only those grids whose level is in [minLevel,maxLevel]
+        and whose world-space bounds overlap the given world-space
+        region, plus those grids' scalars (of all fields). The
+        returned model's grids and fields are compacted, ie, offsets
+        refer to the smaller scalars array */
+    static Model::SP load(const std::string &fileName,
+                          const box3f &worldRegion,
+                          int minLevel=0, int maxLevel=INT_MAX);
     
-    /*! must be one int per level; a value of 'i' means that the
-        respective level's cells are a 2^i refinement of the unit
-        cell, so each cell on that level is 2^{-i} wide */
+    /*! same as the box3f variant, but with the region given as a
+        (inclusive) range of cell indices on level 'regionLevel' */
+    static Model::SP load(const std::string &fileName,
+                          const box3i &cellRegion, int regionLevel,
+                          int minLevel=0, int maxLevel=INT_MAX);
+
+    /*! permutes the grids such that they follow given space-filling
+        curve through their centers, and rewrites the scalars (and
+        grid offsets) such that the grids' scalars are in that order,
+        too; so grids that are close in space are close in memory and
+        on disk. If 'groupByLevel' is true all grids of level 0 come
+        first, then all of level 1, etc. Requires that no two grids
+        share scalars. */
+    void reorderGrids(GridOrder order, bool groupByLevel = false,
+                      int numThreads = 0);
+
+    /*! index of given cell (relative to the grid's origin) of given
+        grid among that grid's scalars, ie, relative to grid.offset */
+    uint64_t cellIndex(const Grid &grid, const vec3i &cell) const
+    { return tamr::cellIndex(cellLayout,grid.dims,cell); }
+
+    /*! re-orders each grid's scalars (of all fields) from the current
+        cell layout to the given one */
+    void setCellLayout(CellLayout layout, int numThreads = 0);
+
+    /*! width of a cell on given level, in the logical space that
+        grid origins are specified in; ie, 1/refinementOfLevel[level] */
+    float cellWidth(int level) const;
+    
+    /*! maps a box from logical space to world space, which is
+        logical space scaled by gridOffset and shifted by
+        gridOrigin */
+    box3f toWorld(const box3f &logical) const;
+    
+    /*! bounds of given grid's cells in logical space */
+    box3f logicalBounds(const Grid &grid) const;
+    
+    /*! bounds of given grid's cells in world space */
+    box3f worldBounds(const Grid &grid) const;
+    
+    /*! must be one int per level; a value of 'r' means that the
+        respective level's cells are an r-fold refinement of the unit
+        cell, so each cell on that level is 1/r wide (this is what
+        all importers write, typically with r=2^level) */
     std::vector<int>       refinementOfLevel;
     
     /*! array of all scalars, across all grids, across all scalar
         fields */
-    std::vector<float>     scalars;
+    Array<float>           scalars;
     std::vector<FieldMeta> fieldMetas;
-    std::vector<Grid>      grids;
+    Array<Grid>            grids;
     
     /*! total number of cells/scalar values across all bricks; if
         there's a single, one-dimensional scalar field that is the
@@ -107,6 +264,9 @@ namespace tamr {
 
     vec3f gridOrigin = { 0.f, 0.f, 0.f };
     vec3f gridOffset = { 1.f, 1.f, 1.f };
+
+    /*! order of the scalars within each grid; see CellLayout.h */
+    CellLayout cellLayout = CELL_LAYOUT_LINEAR;
     
   };
   
@@ -0,0 +1,167 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/ModelReader.h"
+
+namespace tamr {
+  using namespace tamr::format;
+
+  /*! max number of grid descriptors we read from the file at once */
+  const size_t gridsPerFetch = 4096;
+
+  inline uint64_t numCellsOf(const Model::Grid &grid)
+  { return uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z; }
+
+  const float *ModelReader::Batch::scalars(size_t gridInBatch, int field, int dim) const
+  {
+    const size_t stream = reader->firstStreamOfField[field]+dim;
+    return data.data() + stream*numCells + gridBegin[gridInBatch];
+  }
+
+  ModelReader::ModelReader(const std::string &fileName,
+                           const std::vector<std::string> &fieldNames,
+                           size_t bufferSize,
+                           bool prefetch)
+    : in(fileName,std::ios::binary),
+      bufferSize(bufferSize),
+      prefetch(prefetch)
+  {
+    if (!in.good())
+      throw std::runtime_error("tamr::ModelReader: could not open '"+fileName+"'");
+    layout = readLayout(in);
+    meta = readMetaData(in,layout);
+    scalars = std::make_unique<ScalarReader>(in,layout.get(SECTION_SCALARS));
+
+    std::vector<Model::FieldMeta> allFields = meta->fieldMetas;
+    std::vector<int> fieldIDs;
+    if (fieldNames.empty()) {
+      for (int i=0;i<(int)allFields.size();i++)
+        fieldIDs.push_back(i);
+    } else {
+      for (auto &name : fieldNames) {
+        int fieldID = -1;
+        for (int i=0;i<(int)allFields.size();i++)
+          if (allFields[i].name == name) { fieldID = i; break; }
+        if (fieldID < 0)
+          throw std::runtime_error("tamr::ModelReader: file '"+fileName
+                                   +"' does not contain a field named '"+name+"'");
+        fieldIDs.push_back(fieldID);
+      }
+    }
+
+    meta->fieldMetas.clear();
+    for (int fieldID : fieldIDs) {
+      const Section &range = layout.get(SECTION_FIELD_SCALARS,fieldID);
+      firstStreamOfField.push_back(streamBase.size());
+      for (int dim=0;dim<allFields[fieldID].numDimensions;dim++)
+        streamBase.push_back(range.begin+dim*meta->numCellsAcrossAllGrids);
+      meta->fieldMetas.push_back(allFields[fieldID]);
+    }
+    if (prefetch) startPrefetch();
+  }
+
+  ModelReader::~ModelReader()
+  {
+    if (pending.valid()) pending.wait();
+  }
+
+  void ModelReader::startPrefetch()
+  {
+    pending = std::async(std::launch::async,[this]() { return readBatch(prefetched); });
+  }
+
+  bool ModelReader::next(Batch &batch)
+  {
+    if (!prefetch) return readBatch(batch);
+    if (!pending.valid()) startPrefetch();
+    if (!pending.get()) return false;
+    // double buffering: the app gets the batch we just read, and we
+    // read the one after that into the buffers of the batch the app
+    // is done with
+    std::swap(batch,prefetched);
+    startPrefetch();
+    return true;
+  }
+
+  void ModelReader::rewind()
+  {
+    if (pending.valid()) pending.wait();
+    pending = std::future<bool>();
+    lookAhead.clear();
+    lookAheadBegin  = 0;
+    nextGridToFetch = 0;
+    nextGridID      = 0;
+    if (prefetch) startPrefetch();
+  }
+
+  void ModelReader::fetchGrids()
+  {
+    if (lookAheadBegin < lookAhead.size()) return;
+    const Section &grids = layout.get(SECTION_GRIDS);
+    lookAhead.resize(std::min(gridsPerFetch,size_t(grids.count-nextGridToFetch)));
+    lookAheadBegin = 0;
+    if (lookAhead.empty()) return;
+    in.seekg(grids.offset+nextGridToFetch*sizeof(Model::Grid));
+    in.read((char*)lookAhead.data(),lookAhead.size()*sizeof(Model::Grid));
+    if (!in.good())
+      throw std::runtime_error("tamr::ModelReader: error reading grids");
+    nextGridToFetch += lookAhead.size();
+  }
+
+  bool ModelReader::readBatch(Batch &batch)
+  {
+    batch.reader = this;
+    batch.firstGridID = nextGridID;
+    batch.grids.clear();
+    batch.gridBegin.clear();
+    batch.numCells = 0;
+
+    // collect as many grids as we can fit into our buffer
+    const size_t numStreams = streamBase.size();
+    while (true) {
+      fetchGrids();
+      if (lookAheadBegin == lookAhead.size()) break;
+      const Model::Grid &grid = lookAhead[lookAheadBegin];
+      const uint64_t numBytes
+        = (batch.numCells+numCellsOf(grid))*numStreams*sizeof(float)
+        + (batch.grids.size()+1)*sizeof(Model::Grid);
+      if (!batch.grids.empty() && numBytes > bufferSize) break;
+      batch.grids.push_back(grid);
+      batch.gridBegin.push_back(batch.numCells);
+      batch.numCells += numCellsOf(grid);
+      lookAheadBegin++;
+    }
+    if (batch.grids.empty()) return false;
+    nextGridID += batch.grids.size();
+
+    // read the scalars, one read per stream and run of grids whose
+    // scalars are adjacent in the file
+    batch.data.resize(batch.numCells*numStreams);
+    for (size_t stream=0;stream<numStreams;stream++) {
+      float *block = batch.data.data() + stream*batch.numCells;
+      for (size_t i=0;i<batch.grids.size();) {
+        const uint64_t runBegin = batch.grids[i].offset;
+        const uint64_t dstBegin = batch.gridBegin[i];
+        uint64_t runEnd = runBegin;
+        for (;i<batch.grids.size() && batch.grids[i].offset == runEnd;i++)
+          runEnd += numCellsOf(batch.grids[i]);
+        scalars->read(streamBase[stream]+runBegin,runEnd-runBegin,block+dstBegin);
+      }
+    }
+    return true;
+  }
+
+} // ::tamr
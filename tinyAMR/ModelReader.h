@@ -0,0 +1,128 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/FileFormat.h"
+#include <fstream>
+#include <future>
+
+namespace tamr {
+
+  /*! reads a .tamr file (v1 or v2) in one sequential pass, in
+      batches of consecutive grids plus those grids' scalars; at no
+      point does this hold more than one batch worth of grids and
+      scalars in memory, so this can process files much larger than
+      memory. Unless disabled, the reader reads ahead: while the app
+      is processing one batch, a background thread is already reading
+      the next one (so there are two batches' worth of memory in
+      flight). Typical use:
+
+      ModelReader reader(fileName);
+      ModelReader::Batch batch;
+      while (reader.next(batch))
+        for (size_t i=0;i<batch.grids.size();i++)
+          process(batch.grids[i],batch.scalars(i));
+  */
+  struct ModelReader {
+    struct Batch {
+      /*! pointer to the scalars of the i'th grid in this batch, for
+          the given field (counted among the fields the reader was
+          asked to read) and dimension of that field */
+      const float *scalars(size_t gridInBatch, int field=0, int dim=0) const;
+
+      /*! ID of this batch's first grid; all grids in a batch have
+          consecutive IDs */
+      size_t                   firstGridID = 0;
+      /*! the grids in this batch, exactly as stored in the file;
+          ie, their offsets refer to the file's scalars */
+      std::vector<Model::Grid> grids;
+
+    private:
+      friend struct ModelReader;
+      /*! one block of 'numCells' scalars per stream (ie, per
+          dimension of each field) */
+      std::vector<float>    data;
+      /*! where each grid's scalars start within each block */
+      std::vector<uint64_t> gridBegin;
+      uint64_t              numCells = 0;
+      const ModelReader    *reader = nullptr;
+    };
+
+    /*! opens given file for reading the given fields (or all fields
+        if 'fieldNames' is empty), in batches of at most 'bufferSize'
+        bytes (or a single grid, if that grid is bigger than that).
+        If 'prefetch' is true each batch gets read in the background
+        while the app processes the previous one. */
+    ModelReader(const std::string &fileName,
+                const std::vector<std::string> &fieldNames = {},
+                size_t bufferSize = 64ull<<20,
+                bool prefetch = true);
+
+    /*! waits for any outstanding read-ahead */
+    ~ModelReader();
+
+    /*! reads the next batch; returns false once all grids have been
+        read */
+    bool next(Batch &batch);
+
+    /*! restarts reading at the first grid */
+    void rewind();
+
+    /*! total number of grids in the file */
+    size_t numGrids() const { return layout.get(format::SECTION_GRIDS).count; }
+
+    /*! everything about the model except its grids and scalars; its
+        fieldMetas are the ones this reader reads, in the order the
+        batches store them in */
+    Model::SP meta;
+
+  private:
+    /*! makes sure the look-ahead buffer of grid descriptors holds
+        at least one grid (if any are left) */
+    void fetchGrids();
+    
+    /*! reads the next batch from the file, blocking */
+    bool readBatch(Batch &batch);
+    
+    /*! starts reading the next batch into 'prefetched', in the
+        background */
+    void startPrefetch();
+
+    std::ifstream            in;
+    format::Layout           layout;
+    size_t                   bufferSize;
+    /*! reads (and, if required, decodes) scalar ranges */
+    std::unique_ptr<format::ScalarReader> scalars;
+    /*! for each stream (ie, each dimension of each field read), the
+        index in the file's scalars section of its first scalar */
+    std::vector<uint64_t>    streamBase;
+    std::vector<size_t>      firstStreamOfField;
+    /*! grids read from the file, but not yet handed out */
+    std::vector<Model::Grid> lookAhead;
+    size_t                   lookAheadBegin = 0;
+    size_t                   nextGridToFetch = 0;
+    size_t                   nextGridID = 0;
+
+    bool                     prefetch;
+    /*! batch the background thread reads into; gets swapped with
+        the app's batch once that asks for the next one */
+    Batch                    prefetched;
+    /*! result of readBatch() for 'prefetched', if one is pending */
+    std::future<bool>        pending;
+  };
+
+} // ::tamr
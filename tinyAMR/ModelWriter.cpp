@@ -0,0 +1,272 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/ModelWriter.h"
+#include "tinyAMR/FileFormat.h"
+#include <cstdio>
+
+namespace tamr {
+  using namespace tamr::format;
+
+  /*! writes zeroes to 'out' until 'pos' reaches 'target' */
+  static void padTo(std::ostream &out, uint64_t &pos, uint64_t target)
+  {
+    static const char zeroes[pageSize] = {};
+    while (pos < target) {
+      uint64_t n = std::min(target-pos,pageSize);
+      out.write(zeroes,n);
+      pos += n;
+    }
+  }
+
+  void ModelWriter::Stream::append(const void *data, size_t size)
+  {
+    const char *begin = (const char *)data;
+    numBytes += size;
+    while (size > 0) {
+      size_t n = std::min(size,buffer.size()-bufferUsed);
+      memcpy(buffer.data()+bufferUsed,begin,n);
+      bufferUsed += n;
+      begin += n;
+      size -= n;
+      if (bufferUsed == buffer.size()) flush();
+    }
+  }
+
+  void ModelWriter::Stream::flush()
+  {
+    out->write(buffer.data(),bufferUsed);
+    bufferUsed = 0;
+  }
+
+  ModelWriter::ModelWriter(const std::string &fileName,
+                           const std::vector<Model::FieldMeta> &fields,
+                           size_t bufferSize)
+    : fileName(fileName),
+      out(fileName,std::ios::binary),
+      fields(fields)
+  {
+    if (!out.good())
+      throw std::runtime_error("tamr::ModelWriter: could not open '"
+                               +fileName+"' for writing");
+
+    size_t numStreams = 1;
+    for (auto &field : fields)
+      numStreams += field.numDimensions;
+    const size_t streamBufferSize = std::max(bufferSize/numStreams,(size_t)pageSize);
+
+    auto makeStream = [&](const std::string &suffix) {
+      std::unique_ptr<Stream> stream = std::make_unique<Stream>();
+      stream->buffer.resize(streamBufferSize);
+      if (suffix.empty()) {
+        stream->out = &out;
+      } else {
+        stream->tempFileName = fileName+suffix+".tmp";
+        stream->tempFile.open(stream->tempFileName,std::ios::binary);
+        if (!stream->tempFile.good())
+          throw std::runtime_error("tamr::ModelWriter: could not create temp file '"
+                                   +stream->tempFileName+"'");
+        stream->out = &stream->tempFile;
+      }
+      return stream;
+    };
+    for (size_t fieldID=0;fieldID<fields.size();fieldID++) {
+      firstStreamOfField.push_back(scalarStreams.size());
+      for (int dim=0;dim<fields[fieldID].numDimensions;dim++)
+        scalarStreams.push_back
+          (makeStream(scalarStreams.empty()
+                      ? std::string("")
+                      : ".field"+std::to_string(fieldID)+"."+std::to_string(dim)));
+    }
+    gridStream = makeStream(".grids");
+
+    // reserve space for header and table of contents; the first
+    // field's scalars go right after that
+    const uint64_t numSections = 5 + fields.size();
+    uint64_t pos = 0;
+    scalarsBegin = alignUp(sizeof(Header)+numSections*sizeof(Section),pageSize);
+    padTo(out,pos,scalarsBegin);
+  }
+
+  ModelWriter::~ModelWriter()
+  {
+    if (closed) return;
+    try {
+      close();
+    } catch (std::exception &e) {
+      std::cerr << "tamr::ModelWriter: " << e.what() << std::endl;
+    }
+  }
+
+  size_t ModelWriter::addGrid(const Model::Grid &grid)
+  {
+    Model::Grid g = grid;
+    g.offset = numCells;
+    numCells += uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+    gridStream->append(&g,sizeof(g));
+    return numGrids++;
+  }
+
+  size_t ModelWriter::addGrid(const Model::Grid &grid,
+                              const std::vector<const float *> &scalarsOfField)
+  {
+    if (scalarsOfField.size() != fields.size())
+      throw std::runtime_error("tamr::ModelWriter: need scalars for every field");
+    const size_t numCellsOfGrid = size_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+    for (size_t fieldID=0;fieldID<fields.size();fieldID++)
+      for (int dim=0;dim<fields[fieldID].numDimensions;dim++)
+        addScalars((int)fieldID,scalarsOfField[fieldID]+dim*numCellsOfGrid,
+                   numCellsOfGrid,dim);
+    return addGrid(grid);
+  }
+
+  void ModelWriter::addScalars(int fieldID, const float *scalars, size_t count, int dim)
+  {
+    if (fieldID < 0 || fieldID >= (int)fields.size() ||
+        dim < 0 || dim >= fields[fieldID].numDimensions)
+      throw std::runtime_error("tamr::ModelWriter: invalid field or dimension");
+    scalarStreams[firstStreamOfField[fieldID]+dim]->append(scalars,count*sizeof(float));
+  }
+
+  void ModelWriter::appendTempFile(Stream &stream)
+  {
+    stream.tempFile.close();
+    std::ifstream in(stream.tempFileName,std::ios::binary);
+    uint64_t remaining = stream.numBytes;
+    while (remaining > 0) {
+      size_t n = std::min((uint64_t)stream.buffer.size(),remaining);
+      in.read(stream.buffer.data(),n);
+      if (!in.good())
+        throw std::runtime_error("tamr::ModelWriter: error reading temp file");
+      out.write(stream.buffer.data(),n);
+      remaining -= n;
+    }
+    in.close();
+    std::remove(stream.tempFileName.c_str());
+  }
+
+  void ModelWriter::close()
+  {
+    if (closed) return;
+    try {
+      finish();
+    } catch (...) {
+      discard();
+      closed = true;
+      throw;
+    }
+    closed = true;
+  }
+
+  void ModelWriter::discard()
+  {
+    std::vector<Stream *> streams = { gridStream.get() };
+    for (auto &stream : scalarStreams)
+      streams.push_back(stream.get());
+    for (auto stream : streams)
+      if (stream && stream->out != &out) {
+        stream->tempFile.close();
+        std::remove(stream->tempFileName.c_str());
+      }
+    out.close();
+    std::remove(fileName.c_str());
+  }
+
+  void ModelWriter::finish()
+  {
+    for (auto &stream : scalarStreams) stream->flush();
+    gridStream->flush();
+    for (auto &stream : scalarStreams)
+      if (stream->numBytes != numCells*sizeof(float))
+        throw std::runtime_error("tamr::ModelWriter: number of scalars in some field "
+                                 "does not match number of cells across all grids");
+
+    std::vector<Section> sections;
+    auto addSection = [&](uint32_t type, uint32_t index, uint64_t offset,
+                          uint64_t size, uint64_t count) {
+      Section section = {};
+      section.type   = type;
+      section.index  = index;
+      section.offset = offset;
+      section.size   = size;
+      section.count  = count;
+      sections.push_back(section);
+    };
+
+    // scalars: first stream is already in place, all others get
+    // appended, with every field starting at a 64-byte boundary
+    uint64_t pos = scalarsBegin;
+    for (size_t fieldID=0;fieldID<fields.size();fieldID++) {
+      padTo(out,pos,alignUp(pos,sectionAlignment));
+      fields[fieldID].offset = (pos-scalarsBegin)/sizeof(float);
+      for (int dim=0;dim<fields[fieldID].numDimensions;dim++) {
+        Stream &stream = *scalarStreams[firstStreamOfField[fieldID]+dim];
+        if (stream.out != &out)
+          appendTempFile(stream);
+        pos += stream.numBytes;
+      }
+    }
+    addSection(SECTION_SCALARS,0,scalarsBegin,pos-scalarsBegin,
+               (pos-scalarsBegin)/sizeof(float));
+
+    padTo(out,pos,alignUp(pos,alignmentFor(gridStream->numBytes)));
+    addSection(SECTION_GRIDS,0,pos,gridStream->numBytes,numGrids);
+    appendTempFile(*gridStream);
+    pos += gridStream->numBytes;
+
+    auto writeSection = [&](uint32_t type, const void *data,
+                            uint64_t size, uint64_t count) {
+      padTo(out,pos,alignUp(pos,alignmentFor(size)));
+      addSection(type,0,pos,size,count);
+      out.write((const char *)data,size);
+      pos += size;
+    };
+    writeSection(SECTION_REFINEMENT_OF_LEVEL,refinementOfLevel.data(),
+                 refinementOfLevel.size()*sizeof(int),refinementOfLevel.size());
+    const std::string metas = serializeFieldMetas(fields);
+    writeSection(SECTION_FIELD_METAS,metas.data(),metas.size(),fields.size());
+    writeSection(SECTION_USER_META,userMeta.data(),userMeta.size(),userMeta.size());
+
+    const Section scalars = sections[0];
+    for (size_t fieldID=0;fieldID<fields.size();fieldID++) {
+      Section section = {};
+      section.type   = SECTION_FIELD_SCALARS;
+      section.index  = (uint32_t)fieldID;
+      section.begin  = fields[fieldID].offset;
+      section.count  = numScalarsOf(fields[fieldID],numCells,scalars.count);
+      section.offset = scalars.offset + section.begin*sizeof(float);
+      section.size   = section.count*sizeof(float);
+      sections.push_back(section);
+    }
+
+    Header header = {};
+    header.magic       = magic;
+    header.version     = version;
+    header.numSections = (uint32_t)sections.size();
+    header.tocOffset   = sizeof(Header);
+    header.numCellsAcrossAllGrids = numCells;
+    header.gridOrigin  = gridOrigin;
+    header.gridOffset  = gridOffset;
+    header.cellLayout  = cellLayout;
+    out.seekp(0);
+    out.write((const char *)&header,sizeof(header));
+    out.write((const char *)sections.data(),sections.size()*sizeof(Section));
+    out.close();
+    if (out.fail())
+      throw std::runtime_error("tamr::ModelWriter: error writing '"+fileName+"'");
+  }
+
+} // ::tamr
@@ -0,0 +1,114 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Model.h"
+#include <fstream>
+
+namespace tamr {
+
+  /*! writes a (v2) .tamr file incrementally, without ever having the
+      entire model in memory: importers append grids and scalars as
+      they produce them, and the file gets finalized in close().
+
+      Grids and scalars are independent streams: every grid appended
+      through addGrid() gets assigned the next 'dims.x*dims.y*dims.z'
+      cells, and each field (or, for multi-dimensional fields, each
+      dimension of that field) is a separate stream of scalars that
+      must, by the time close() gets called, contain exactly one
+      scalar per cell. The first field's scalars get written straight
+      into the output file; all other streams get spilled into
+      temporary files next to the output file, which get appended
+      (and removed) in close(). Memory use is thus bounded by
+      'bufferSize', no matter how large the model. */
+  struct ModelWriter {
+    /*! creates writer for a model with the given fields; the
+        fields' offsets will be ignored (and get computed by the
+        writer) */
+    ModelWriter(const std::string &fileName,
+                const std::vector<Model::FieldMeta> &fields,
+                size_t bufferSize = 64ull<<20);
+
+    /*! closes the file if not already done */
+    ~ModelWriter();
+
+    /*! appends a grid, assigning its offset; returns the grid's ID */
+    size_t addGrid(const Model::Grid &grid);
+
+    /*! appends a grid, and the scalars of that grid for every field
+        (where 'scalarsOfField[f]' points to the grid's cells for
+        field 'f', and all dimensions of that field, in the order
+        they are stored in) */
+    size_t addGrid(const Model::Grid &grid,
+                   const std::vector<const float *> &scalarsOfField);
+
+    /*! appends 'count' scalars to given dimension of given field */
+    void addScalars(int fieldID, const float *scalars, size_t count, int dim=0);
+
+    /*! finalizes the file; throws if the number of scalars in any
+        field does not match the number of cells in all grids, in
+        which case the temp files and the incomplete output file get
+        removed */
+    void close();
+
+    /*! those can be set any time before close() */
+    std::vector<int> refinementOfLevel;
+    std::string      userMeta;
+    vec3f            gridOrigin = { 0.f, 0.f, 0.f };
+    vec3f            gridOffset = { 1.f, 1.f, 1.f };
+    /*! order the scalars passed to addGrid/addScalars are in */
+    CellLayout       cellLayout = CELL_LAYOUT_LINEAR;
+
+  private:
+    /*! a stream of (fixed-size) elements, written either into the
+        output file or into its own temp file, through a buffer */
+    struct Stream {
+      void append(const void *data, size_t size);
+      void flush();
+
+      std::ofstream     *out = nullptr;
+      std::ofstream      tempFile;
+      std::string        tempFileName;
+      std::vector<char>  buffer;
+      size_t             bufferUsed = 0;
+      uint64_t           numBytes   = 0;
+    };
+
+    /*! appends the contents of given (already flushed) stream's temp
+        file to the output file, and removes it */
+    void appendTempFile(Stream &stream);
+
+    /*! writes everything that isn't written yet, and the header */
+    void finish();
+
+    /*! removes all temp files, and the (incomplete) output file */
+    void discard();
+
+    std::string                           fileName;
+    std::ofstream                         out;
+    std::vector<Model::FieldMeta>         fields;
+    /*! one stream per dimension of each field, in order */
+    std::vector<std::unique_ptr<Stream>>  scalarStreams;
+    std::vector<size_t>                   firstStreamOfField;
+    std::unique_ptr<Stream>               gridStream;
+    uint64_t                              numCells  = 0;
+    uint64_t                              numGrids  = 0;
+    uint64_t                              scalarsBegin = 0;
+    bool                                  closed = false;
+  };
+
+} // ::tamr
@@ -0,0 +1,113 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/ParallelIO.h"
+#include "tinyAMR/parallel_for.h"
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace tamr {
+
+  /*! splits requests into chunks of at most 'chunkSize' bytes */
+  static std::vector<IORequest> splitIntoChunks(const std::vector<IORequest> &requests,
+                                                uint64_t chunkSize)
+  {
+    chunkSize = std::max(chunkSize,(uint64_t)1);
+    std::vector<IORequest> chunks;
+    for (auto &request : requests)
+      for (uint64_t begin=0;begin<request.size;begin+=chunkSize)
+        chunks.push_back({(char*)request.data+begin,
+                          std::min(chunkSize,request.size-begin),
+                          request.offset+begin});
+    return chunks;
+  }
+
+#ifndef _WIN32
+  /*! performs one chunk of I/O, retrying on short reads/writes */
+  template<typename Op>
+  static void doChunk(const IORequest &chunk, const Op &op, const char *what)
+  {
+    char    *data   = (char*)chunk.data;
+    uint64_t offset = chunk.offset;
+    uint64_t size   = chunk.size;
+    while (size > 0) {
+      ssize_t n = op(data,size,offset);
+      if (n <= 0)
+        throw std::runtime_error(std::string("tamr: error ")+what+" file");
+      data   += n;
+      offset += n;
+      size   -= n;
+    }
+  }
+#endif
+
+  void readParallel(const std::string &fileName,
+                    const std::vector<IORequest> &requests,
+                    const IOOptions &options)
+  {
+#ifdef _WIN32
+    throw std::runtime_error("tamr: parallel I/O not supported on windows");
+#else
+    int fd = ::open(fileName.c_str(),O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("tamr: could not open '"+fileName+"'");
+    std::vector<IORequest> chunks = splitIntoChunks(requests,options.chunkSize);
+    try {
+      parallel_for(chunks.size(),[&](size_t chunkID){
+        doChunk(chunks[chunkID],[&](char *data, uint64_t size, uint64_t offset)
+                { return ::pread(fd,data,size,offset); },"reading");
+      },options.numThreads);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd);
+#endif
+  }
+
+  void writeParallel(const std::string &fileName,
+                     uint64_t fileSize,
+                     const std::vector<IORequest> &requests,
+                     const IOOptions &options)
+  {
+#ifdef _WIN32
+    throw std::runtime_error("tamr: parallel I/O not supported on windows");
+#else
+    int fd = ::open(fileName.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if (fd < 0)
+      throw std::runtime_error("tamr: could not open '"+fileName+"' for writing");
+    std::vector<IORequest> chunks = splitIntoChunks(requests,options.chunkSize);
+    try {
+      // sizing the file up front makes all gaps between sections
+      // read as zeroes, so we only have to write actual data
+      if (::ftruncate(fd,fileSize) != 0)
+        throw std::runtime_error("tamr: could not resize '"+fileName+"'");
+      parallel_for(chunks.size(),[&](size_t chunkID){
+        doChunk(chunks[chunkID],[&](char *data, uint64_t size, uint64_t offset)
+                { return ::pwrite(fd,data,size,offset); },"writing");
+      },options.numThreads);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    if (::close(fd) != 0)
+      throw std::runtime_error("tamr: error writing '"+fileName+"'");
+#endif
+  }
+
+} // ::tamr
@@ -0,0 +1,47 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Model.h"
+
+namespace tamr {
+
+  /*! one contiguous range of a file, and the memory it gets read
+      into (or written from) */
+  struct IORequest {
+    void    *data;
+    uint64_t size;
+    /*! byte offset within the file */
+    uint64_t offset;
+  };
+
+  /*! reads all given requests from given file; requests get split
+      into chunks of (at most) options.chunkSize bytes that get read
+      concurrently, with pread, by options.numThreads threads */
+  void readParallel(const std::string &fileName,
+                    const std::vector<IORequest> &requests,
+                    const IOOptions &options);
+
+  /*! creates (or truncates) given file, sizes it to 'fileSize'
+      bytes, and writes all given requests into it concurrently, with
+      pwrite; all bytes not covered by any request will be zero */
+  void writeParallel(const std::string &fileName,
+                     uint64_t fileSize,
+                     const std::vector<IORequest> &requests,
+                     const IOOptions &options);
+
+} // ::tamr
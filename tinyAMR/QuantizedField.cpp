@@ -0,0 +1,279 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/QuantizedField.h"
+#include "tinyAMR/ModelReader.h"
+#include "tinyAMR/parallel_for.h"
+#include <cmath>
+#include <limits>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# include <immintrin.h>
+# define TAMR_HAVE_F16C_PATH 1
+#endif
+
+namespace tamr {
+
+  uint16_t floatToHalf(float f)
+  {
+    uint32_t bits;
+    memcpy(&bits,&f,4);
+    const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+    const uint32_t abs  = bits & 0x7fffffff;
+    if (abs >= 0x7f800000)
+      // inf, or NaN (which we keep a NaN)
+      return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+    if (abs >= 0x477ff000)
+      // 65520 and above round to inf
+      return sign | 0x7c00;
+    if (abs < 0x38800000) {
+      // becomes a denormal (or zero): count in units of 2^-24
+      float a;
+      memcpy(&a,&abs,4);
+      return sign | uint16_t(std::nearbyint(a*16777216.f));
+    }
+    const uint32_t exp  = (abs >> 23) - 112;
+    const uint32_t mant = abs & 0x7fffff;
+    uint32_t half = (exp << 10) | (mant >> 13);
+    const uint32_t rest = mant & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+      half++;
+    return sign | uint16_t(half);
+  }
+
+  float halfToFloat(uint16_t h)
+  {
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    const uint32_t exp  = (h >> 10) & 0x1f;
+    const uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0) {
+      const float f = mant*(1.f/16777216.f);
+      memcpy(&bits,&f,4);
+      bits |= sign;
+    } else if (exp == 31)
+      bits = sign | 0x7f800000 | (mant << 13);
+    else
+      bits = sign | ((exp+112) << 23) | (mant << 13);
+    float f;
+    memcpy(&f,&bits,4);
+    return f;
+  }
+
+#if TAMR_HAVE_F16C_PATH
+  __attribute__((target("avx,f16c")))
+  static void halfToFloat_f16c(const uint16_t *in, float *out, size_t count)
+  {
+    size_t i = 0;
+    for (;i+8<=count;i+=8)
+      _mm256_storeu_ps(out+i,_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in+i))));
+    for (;i<count;i++)
+      out[i] = halfToFloat(in[i]);
+  }
+
+  static bool haveF16C()
+  {
+    static const bool have
+      = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return have;
+  }
+#endif
+
+  /*! the unorm formats' dequantization loops are written such that
+      the compiler vectorizes them */
+  template<typename T>
+  static void dequantizeUnorm(const T *in, float *out, size_t count,
+                              float lower, float scale)
+  {
+    for (size_t i=0;i<count;i++)
+      out[i] = lower + in[i]*scale;
+  }
+
+  static void dequantizeBF16(const uint16_t *in, float *out, size_t count)
+  {
+    for (size_t i=0;i<count;i++) {
+      const uint32_t bits = uint32_t(in[i]) << 16;
+      memcpy(out+i,&bits,4);
+    }
+  }
+
+  static void dequantizeFP16(const uint16_t *in, float *out, size_t count)
+  {
+#if TAMR_HAVE_F16C_PATH
+    if (haveF16C()) {
+      halfToFloat_f16c(in,out,count);
+      return;
+    }
+#endif
+    for (size_t i=0;i<count;i++)
+      out[i] = halfToFloat(in[i]);
+  }
+
+  template<typename T>
+  static void quantizeUnorm(const float *in, T *out, size_t count,
+                            QuantizedField::GridRange &range)
+  {
+    const float maxQ = float(std::numeric_limits<T>::max());
+    float lo = INFINITY, hi = -INFINITY;
+    for (size_t i=0;i<count;i++)
+      if (std::isfinite(in[i])) {
+        lo = std::min(lo,in[i]);
+        hi = std::max(hi,in[i]);
+      }
+    if (lo > hi) lo = hi = 0.f;
+    range.lower = lo;
+    range.scale = (hi-lo)/maxQ;
+    const float rcpScale = range.scale > 0.f ? 1.f/range.scale : 0.f;
+    for (size_t i=0;i<count;i++) {
+      const float q = std::isnan(in[i]) ? 0.f : std::round((in[i]-lo)*rcpScale);
+      out[i] = T(std::min(std::max(q,0.f),maxQ));
+    }
+  }
+
+  static_assert(int(QuantizedField::FORMAT_FP16)    == int(IOOptions::QUANTIZE_FP16) &&
+                int(QuantizedField::FORMAT_BF16)    == int(IOOptions::QUANTIZE_BF16) &&
+                int(QuantizedField::FORMAT_UNORM8)  == int(IOOptions::QUANTIZE_UNORM8) &&
+                int(QuantizedField::FORMAT_UNORM16) == int(IOOptions::QUANTIZE_UNORM16),
+                "QuantizedField::Format and IOOptions::Quantization have to match");
+
+  void QuantizedField::quantize(Format format, const float *values, uint64_t count,
+                                void *out, GridRange &range)
+  {
+    switch (format) {
+    case FORMAT_FP16:
+      for (uint64_t i=0;i<count;i++)
+        ((uint16_t*)out)[i] = floatToHalf(values[i]);
+      break;
+    case FORMAT_BF16:
+      for (uint64_t i=0;i<count;i++)
+        ((uint16_t*)out)[i] = floatToBF16(values[i]);
+      break;
+    case FORMAT_UNORM8:
+      quantizeUnorm(values,(uint8_t*)out,count,range);
+      break;
+    case FORMAT_UNORM16:
+      quantizeUnorm(values,(uint16_t*)out,count,range);
+      break;
+    }
+  }
+
+  void QuantizedField::dequantize(Format format, const void *in, uint64_t count,
+                                  float *dst, const GridRange &range)
+  {
+    switch (format) {
+    case FORMAT_FP16:
+      dequantizeFP16((const uint16_t*)in,dst,count);
+      break;
+    case FORMAT_BF16:
+      dequantizeBF16((const uint16_t*)in,dst,count);
+      break;
+    case FORMAT_UNORM8:
+      dequantizeUnorm((const uint8_t*)in,dst,count,range.lower,range.scale);
+      break;
+    case FORMAT_UNORM16:
+      dequantizeUnorm((const uint16_t*)in,dst,count,range.lower,range.scale);
+      break;
+    }
+  }
+
+  void QuantizedField::quantizeGrid(size_t gridID, const float *values)
+  {
+    quantize(format,values,gridNumCells[gridID],
+             data.data() + gridOffset[gridID]*bytesPerScalar(),
+             gridRange[gridID]);
+  }
+
+  QuantizedField::SP QuantizedField::quantize(const Model &model, int fieldID,
+                                              Format format, int dim)
+  {
+    if (fieldID < 0 || fieldID >= (int)model.fieldMetas.size() ||
+        dim < 0 || dim >= model.fieldMetas[fieldID].numDimensions)
+      throw std::runtime_error("tamr::QuantizedField: invalid field or dimension");
+    const uint64_t base
+      = model.fieldMetas[fieldID].offset + dim*model.numCellsAcrossAllGrids;
+
+    QuantizedField::SP field = std::make_shared<QuantizedField>();
+    field->format = format;
+    field->data.resize(model.numCellsAcrossAllGrids*field->bytesPerScalar());
+    field->gridRange.resize(model.grids.size());
+    for (auto &grid : model.grids) {
+      const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+      if (grid.offset+numCells > model.numCellsAcrossAllGrids ||
+          base+grid.offset+numCells > model.scalars.size())
+        throw std::runtime_error("tamr::QuantizedField: grid scalars out of range");
+      field->gridOffset.push_back(grid.offset);
+      field->gridNumCells.push_back(numCells);
+    }
+    parallel_for(model.grids.size(),[&](size_t gridID){
+      field->quantizeGrid(gridID,model.scalars.data()+base+model.grids[gridID].offset);
+    });
+    return field;
+  }
+
+  QuantizedField::SP QuantizedField::load(const std::string &fileName,
+                                          const std::string &fieldName,
+                                          Format format, int dim)
+  {
+    ModelReader reader(fileName,{fieldName});
+    if (dim < 0 || dim >= reader.meta->fieldMetas[0].numDimensions)
+      throw std::runtime_error("tamr::QuantizedField: invalid field dimension");
+
+    QuantizedField::SP field = std::make_shared<QuantizedField>();
+    field->format = format;
+    field->data.resize(reader.meta->numCellsAcrossAllGrids*field->bytesPerScalar());
+    field->gridOffset.resize(reader.numGrids());
+    field->gridNumCells.resize(reader.numGrids());
+    field->gridRange.resize(reader.numGrids());
+    ModelReader::Batch batch;
+    while (reader.next(batch)) {
+      for (size_t i=0;i<batch.grids.size();i++) {
+        const Model::Grid &grid = batch.grids[i];
+        const size_t gridID = batch.firstGridID+i;
+        field->gridOffset[gridID]   = grid.offset;
+        field->gridNumCells[gridID] = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+        if (grid.offset+field->gridNumCells[gridID] > reader.meta->numCellsAcrossAllGrids)
+          throw std::runtime_error("tamr::QuantizedField: grid scalars out of range");
+      }
+      parallel_for(batch.grids.size(),[&](size_t i){
+        field->quantizeGrid(batch.firstGridID+i,batch.scalars(i,0,dim));
+      });
+    }
+    return field;
+  }
+
+  void QuantizedField::dequantize(size_t gridID, float *dst) const
+  {
+    dequantize(format,data.data() + gridOffset[gridID]*bytesPerScalar(),
+               gridNumCells[gridID],dst,gridRange[gridID]);
+  }
+
+  void QuantizedField::dequantize(float *dst, int numThreads) const
+  {
+    parallel_for(gridOffset.size(),[&](size_t gridID){
+      dequantize(gridID,dst+gridOffset[gridID]);
+    },numThreads);
+  }
+
+  float QuantizedField::maxRelativeError() const
+  {
+    switch (format) {
+    case FORMAT_FP16:    return 1.f/2048.f;
+    case FORMAT_BF16:    return 1.f/256.f;
+    case FORMAT_UNORM8:  return .5f/255.f;
+    default:             return .5f/65535.f;
+    }
+  }
+
+} // ::tamr
@@ -0,0 +1,141 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/Model.h"
+#include <cstring>
+
+namespace tamr {
+
+  /*! one dimension of one field of a model, stored in reduced
+      precision: either as 16-bit floats (fp16 or bfloat16), or as 8-
+      or 16-bit unsigned integers that get mapped to each grid's own
+      [lower,upper] range of values. Cells are stored exactly as in
+      Model::scalars, ie, grid 'i''s cells start at
+      data[grids[i].offset*bytesPerScalar()], so this can replace a
+      field's floats one-for-one, at a half or a quarter of the
+      memory. */
+  struct QuantizedField {
+    typedef std::shared_ptr<QuantizedField> SP;
+
+    typedef enum {
+      FORMAT_FP16,
+      FORMAT_BF16,
+      FORMAT_UNORM8,
+      FORMAT_UNORM16,
+    } Format;
+
+    /*! value range of one grid's cells, for the UNORM formats; a
+        stored value of 'q' means lower+q*scale */
+    struct GridRange {
+      float lower;
+      float scale;
+    };
+
+    /*! quantizes given dimension of given field of given model */
+    static SP quantize(const Model &model, int fieldID, Format format, int dim=0);
+
+    /*! loads given field (dimension) from given file, quantizing it
+        on the fly with a ModelReader, without ever having all of its
+        floats in memory */
+    static SP load(const std::string &fileName, const std::string &fieldName,
+                   Format format, int dim=0);
+
+    /*! quantizes 'count' values into 'out', which needs space for
+        count*bytesPerScalar(format) bytes; for the unorm formats this
+        also sets 'range' to those values' range */
+    static void quantize(Format format, const float *values, uint64_t count,
+                         void *out, GridRange &range);
+
+    /*! dequantizes 'count' values that quantize() produced */
+    static void dequantize(Format format, const void *in, uint64_t count,
+                           float *dst, const GridRange &range);
+
+    /*! value of cell 'cellID' (counted within its grid) of grid 'gridID' */
+    inline float get(size_t gridID, uint64_t cellID) const;
+
+    /*! dequantizes all cells of given grid into 'dst' */
+    void dequantize(size_t gridID, float *dst) const;
+
+    /*! dequantizes all cells of all grids into 'dst', which needs to
+        have space for numCellsAcrossAllGrids floats */
+    void dequantize(float *dst, int numThreads = 0) const;
+
+    size_t bytesPerScalar() const
+    { return bytesPerScalar(format); }
+    static size_t bytesPerScalar(Format format)
+    { return (format == FORMAT_UNORM8) ? 1 : 2; }
+
+    /*! maximum error of any value, for the fp formats as a fraction
+        of the value, for the unorm formats as a fraction of the
+        respective grid's value range */
+    float maxRelativeError() const;
+
+    Format                 format;
+    std::vector<uint8_t>   data;
+    /*! one entry per grid of the model this was quantized from, in
+        the same order; gridRange is only used by the unorm formats */
+    std::vector<uint64_t>  gridOffset;
+    std::vector<uint64_t>  gridNumCells;
+    std::vector<GridRange> gridRange;
+
+  private:
+    /*! quantizes the values of the grid with given ID */
+    void quantizeGrid(size_t gridID, const float *values);
+  };
+
+  /*! IEEE half <-> float conversion, with round-to-nearest-even */
+  uint16_t floatToHalf(float f);
+  float    halfToFloat(uint16_t h);
+
+  /*! bfloat16 <-> float conversion, with round-to-nearest-even */
+  inline uint16_t floatToBF16(float f)
+  {
+    uint32_t bits;
+    memcpy(&bits,&f,4);
+    if ((bits & 0x7fffffff) > 0x7f800000)
+      // NaN - make sure it stays one
+      return uint16_t((bits >> 16) | 0x40);
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return uint16_t(bits >> 16);
+  }
+
+  inline float bf16ToFloat(uint16_t h)
+  {
+    uint32_t bits = uint32_t(h) << 16;
+    float f;
+    memcpy(&f,&bits,4);
+    return f;
+  }
+
+  inline float QuantizedField::get(size_t gridID, uint64_t cellID) const
+  {
+    const uint64_t idx = gridOffset[gridID]+cellID;
+    switch (format) {
+    case FORMAT_FP16:
+      return halfToFloat(((const uint16_t*)data.data())[idx]);
+    case FORMAT_BF16:
+      return bf16ToFloat(((const uint16_t*)data.data())[idx]);
+    case FORMAT_UNORM8:
+      return gridRange[gridID].lower + data[idx]*gridRange[gridID].scale;
+    default:
+      return gridRange[gridID].lower
+        + ((const uint16_t*)data.data())[idx]*gridRange[gridID].scale;
+    }
+  }
+
+} // ::tamr
@@ -0,0 +1,145 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/RayIterator.h"
+
+namespace tamr {
+
+  RayIterator::RayIterator(const GridIndex &index, const vec3f &org, const vec3f &dir,
+                           float tMin, float tMax)
+    : index(index),
+      model(index.model),
+      org(org),
+      dir(dir),
+      rcpDir(safeRcp(dir)),
+      tMax(tMax),
+      t(tMin)
+  {
+    // a small fraction of the smallest cell - but still large enough
+    // to actually move the point - in ray parameter units
+    float minWidth = INFINITY;
+    for (int level=0;level<(int)model.refinementOfLevel.size();level++)
+      minWidth = std::min(minWidth,model.cellWidth(level));
+    const float length = sqrtf(dot(dir,dir));
+    epsilon = std::max(1e-4f*minWidth*reduce_min(model.gridOffset),
+                       1e-6f*reduce_max(max(org,-org)))/length;
+    if (!(length > 0.f))
+      // a ray that doesn't go anywhere doesn't cross anything
+      t = tMax;
+  }
+
+  float RayIterator::nudge(float t) const
+  {
+    return t+std::max(epsilon,fabsf(t)*1e-6f);
+  }
+
+  bool RayIterator::enterNextGrid()
+  {
+    while (t < tMax) {
+      const GridIndex::Hit hit = index.locate(org+nudge(t)*dir);
+      const float tNudged = nudge(t);
+      if (!hit.valid()) {
+        // skip ahead to the next grid along the ray, if any
+        const float tEnter
+          = index.firstIntersected(org,dir,t,tMax,[&](size_t, float, float t1) {
+              return t1 > tNudged;
+            });
+        if (tEnter == INFINITY) return false;
+        t = std::max(tEnter,tNudged);
+        continue;
+      }
+
+      gridID = (uint32_t)hit.gridID;
+      const Model::Grid &grid = model.grids[gridID];
+      const float width = model.cellWidth(grid.level);
+
+      // we stay in this grid until we leave it, or enter a finer one
+      // before that
+      float tEnterGrid = t, tExit = tMax;
+      if (!clipRay(model.worldBounds(grid),org,rcpDir,tEnterGrid,tExit))
+        tExit = tNudged;
+      tExit = std::max(tExit,tNudged);
+      const float tEnterFiner
+        = index.firstIntersected(org,dir,t,tExit,[&](size_t otherID, float, float t1) {
+            return t1 > tNudged && model.cellWidth(model.grids[otherID].level) < width;
+          });
+      // (tLeave is always a bit after t, even if we only graze the
+      // grid, so every grid we enter moves us along the ray)
+      tLeave = std::min(std::min(tExit,tMax),std::max(tEnterFiner,tNudged));
+
+      // DDA, in the grid's cell coordinates, where the ray is
+      // q(t) = qOrg + t*qDir
+      const vec3f qOrg = (org-model.gridOrigin)/model.gridOffset/width-vec3f(grid.origin);
+      const vec3f qDir = dir/model.gridOffset/width;
+      cell = hit.cell;
+      for (int axis=0;axis<3;axis++) {
+        if (qDir[axis] > 0.f) {
+          step[axis]   = 1;
+          tNext[axis]  = (cell[axis]+1-qOrg[axis])/qDir[axis];
+          tDelta[axis] = 1.f/qDir[axis];
+        } else if (qDir[axis] < 0.f) {
+          step[axis]   = -1;
+          tNext[axis]  = (cell[axis]-qOrg[axis])/qDir[axis];
+          tDelta[axis] = -1.f/qDir[axis];
+        } else {
+          step[axis]   = 0;
+          tNext[axis]  = INFINITY;
+          tDelta[axis] = INFINITY;
+        }
+      }
+      inGrid = true;
+      return true;
+    }
+    return false;
+  }
+
+  bool RayIterator::next(Segment &segment)
+  {
+    while (true) {
+      if (!inGrid && !enterNextGrid())
+        return false;
+
+      const int axis
+        = (tNext.x <= tNext.y && tNext.x <= tNext.z) ? 0
+        : (tNext.y <= tNext.z ? 1 : 2);
+      const float t1 = std::min(tNext[axis],tLeave);
+      segment.gridID = gridID;
+      segment.cell   = cell;
+      segment.t0     = t;
+      segment.t1     = t1;
+
+      if (t1 >= tLeave) {
+        // done with this grid
+        inGrid = false;
+        t = std::max(t,tLeave);
+      } else {
+        t = std::max(t,t1);
+        const int dim = model.grids[gridID].dims[axis];
+        if (cell[axis]+step[axis] < 0 || cell[axis]+step[axis] >= dim)
+          // (numerically) stepped out of the grid before tLeave, when
+          // running almost parallel to its side: stay in this cell
+          tNext[axis] = INFINITY;
+        else {
+          cell[axis]  += step[axis];
+          tNext[axis] += tDelta[axis];
+        }
+      }
+      if (segment.t1 > segment.t0)
+        return true;
+    }
+  }
+
+} // ::tamr
@@ -0,0 +1,84 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/GridIndex.h"
+
+namespace tamr {
+
+  /*! walks a (world-space) ray through a model, front to back, one
+      cell at a time, always in the finest grid there is at any point
+      along the ray. Within a grid this is a 3D-DDA; whenever the ray
+      leaves that grid, or enters a finer one, the GridIndex tells
+      where to continue. Regions that no grid covers are skipped.
+      Typical use:
+
+      RayIterator ray(index,org,dir);
+      RayIterator::Segment segment;
+      while (ray.next(segment))
+        integrate(segment.gridID,segment.cell,segment.t0,segment.t1);
+
+      An iterator is for one ray only, and is cheap to create; any
+      number of threads can trace rays through the same index at the
+      same time. */
+  struct RayIterator {
+    /*! one cell the ray passes through */
+    struct Segment {
+      uint32_t gridID;
+      /*! the cell within that grid, relative to the grid's origin */
+      vec3i    cell;
+      /*! where along the ray it enters and leaves that cell */
+      float    t0, t1;
+    };
+
+    RayIterator(const GridIndex &index, const vec3f &org, const vec3f &dir,
+                float tMin = 0.f, float tMax = INFINITY);
+
+    /*! returns the next segment along the ray, if there is one */
+    bool next(Segment &segment);
+
+  private:
+    /*! finds the grid at 't', and sets up the DDA through it; returns
+        false if there's no grid anywhere along the rest of the ray */
+    bool enterNextGrid();
+
+    /*! a tiny bit further along the ray than 't' */
+    float nudge(float t) const;
+
+    const GridIndex &index;
+    const Model     &model;
+    const vec3f      org, dir;
+    const vec3f      rcpDir;
+    const float      tMax;
+    /*! tiny distance along the ray, for stepping over boundaries */
+    float            epsilon;
+
+    /*! where along the ray we are */
+    float            t;
+    bool             inGrid = false;
+
+    // state of the DDA in the current grid
+    uint32_t         gridID;
+    /*! where the ray leaves the current grid, or enters a finer one */
+    float            tLeave;
+    vec3i            cell;
+    vec3i            step;
+    vec3f            tNext;
+    vec3f            tDelta;
+  };
+
+} // ::tamr
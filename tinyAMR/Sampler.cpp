@@ -0,0 +1,181 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/Sampler.h"
+#include "tinyAMR/parallel_for.h"
+#include <algorithm>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# include <immintrin.h>
+# define TAMR_HAVE_GATHER_PATH 1
+#endif
+
+namespace tamr {
+
+  /*! number of points that one job locates, groups by grid, and
+      evaluates */
+  const size_t pointsPerJob = 4096;
+
+  /*! out[i] = base[idx[i]], for all i in [0,count) */
+  typedef void (*GatherFct)(const float *base, const int32_t *idx,
+                            float *out, size_t count);
+
+  static void gather_scalar(const float *base, const int32_t *idx,
+                            float *out, size_t count)
+  {
+    for (size_t i=0;i<count;i++)
+      out[i] = base[idx[i]];
+  }
+
+#if TAMR_HAVE_GATHER_PATH
+  __attribute__((target("avx2")))
+  static void gather_avx2(const float *base, const int32_t *idx,
+                          float *out, size_t count)
+  {
+    size_t i = 0;
+    for (;i+8<=count;i+=8)
+      _mm256_storeu_ps(out+i,_mm256_i32gather_ps
+                       (base,_mm256_loadu_si256((const __m256i*)(idx+i)),4));
+    for (;i<count;i++)
+      out[i] = base[idx[i]];
+  }
+
+  __attribute__((target("avx512f")))
+  static void gather_avx512(const float *base, const int32_t *idx,
+                            float *out, size_t count)
+  {
+    size_t i = 0;
+    for (;i+16<=count;i+=16)
+      _mm512_storeu_ps(out+i,_mm512_i32gather_ps
+                       (_mm512_loadu_si512(idx+i),base,4));
+    for (;i<count;i++)
+      out[i] = base[idx[i]];
+  }
+#endif
+
+  static GatherFct gatherFunction()
+  {
+#if TAMR_HAVE_GATHER_PATH
+    static const GatherFct fct
+      = __builtin_cpu_supports("avx512f") ? gather_avx512
+      : __builtin_cpu_supports("avx2")    ? gather_avx2
+      : gather_scalar;
+    return fct;
+#else
+    return gather_scalar;
+#endif
+  }
+
+  Sampler::Sampler(const Model &model, int numThreads)
+    : numThreads(numThreads),
+      model(model),
+      index(model,numThreads)
+  {}
+
+  void Sampler::sample(int fieldID, const vec3f *points, float *out, size_t n,
+                       int dim) const
+  {
+    const Model::FieldMeta &meta = model.fieldMetas.at(fieldID);
+    if (dim < 0 || dim >= meta.numDimensions)
+      throw std::runtime_error("tamr::Sampler: invalid field dimension");
+    const float *fieldScalars
+      = model.scalars.data()+meta.offset+dim*model.numCellsAcrossAllGrids;
+    const GatherFct gather = gatherFunction();
+
+    struct Query {
+      uint32_t gridID;
+      /*! relative to the job's first point */
+      uint32_t pointID;
+      vec3i    cell;
+    };
+    const size_t numJobs = (n+pointsPerJob-1)/pointsPerJob;
+    parallel_for(numJobs,[&](size_t jobID) {
+      const size_t begin = jobID*pointsPerJob;
+      const size_t end   = std::min(n,begin+pointsPerJob);
+
+      std::vector<Query> queries;
+      queries.reserve(end-begin);
+      for (size_t i=begin;i<end;i++) {
+        const GridIndex::Hit hit = index.locate(points[i]);
+        if (hit.valid())
+          queries.push_back({(uint32_t)hit.gridID,uint32_t(i-begin),hit.cell});
+        else
+          out[i] = outside;
+      }
+      // group by grid, so we can fetch each grid's values in one go
+      std::sort(queries.begin(),queries.end(),
+                [](const Query &a, const Query &b) { return a.gridID < b.gridID; });
+
+      std::vector<int32_t> idx(queries.size());
+      std::vector<float>   values(queries.size());
+      std::vector<float>   result(queries.size());
+      std::vector<vec3i>   lower(queries.size());
+      std::vector<vec3f>   frac(queries.size());
+      for (size_t runBegin=0;runBegin<queries.size();) {
+        size_t runEnd = runBegin+1;
+        while (runEnd < queries.size() && queries[runEnd].gridID == queries[runBegin].gridID)
+          runEnd++;
+        const Model::Grid &grid = model.grids[queries[runBegin].gridID];
+        if (uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z >= (1ull<<31))
+          throw std::runtime_error("tamr::Sampler: grid too large");
+        const float *base = fieldScalars+grid.offset;
+        const size_t count = runEnd-runBegin;
+
+        if (filter == FILTER_NEAREST) {
+          for (size_t k=0;k<count;k++)
+            idx[k] = (int32_t)model.cellIndex(grid,queries[runBegin+k].cell);
+          gather(base,idx.data(),values.data(),count);
+          for (size_t k=0;k<count;k++)
+            out[begin+queries[runBegin+k].pointID] = values[k];
+        } else {
+          // position relative to the grid's cell centers
+          const float width = model.cellWidth(grid.level);
+          const vec3i maxCell = grid.dims-vec3i(1);
+          for (size_t k=0;k<count;k++) {
+            const vec3f logical
+              = (points[begin+queries[runBegin+k].pointID]-model.gridOrigin)/model.gridOffset;
+            const vec3f pos = logical/width-vec3f(grid.origin)-vec3f(.5f);
+            const vec3f f(floorf(pos.x),floorf(pos.y),floorf(pos.z));
+            const vec3i i0 = max(vec3i(0),min(maxCell,vec3i(f)));
+            lower[k] = i0;
+            frac[k]  = max(vec3f(0.f),min(vec3f(1.f),pos-vec3f(i0)));
+            // no neighbor to interpolate with on the upper side
+            if (i0.x == maxCell.x) frac[k].x = 0.f;
+            if (i0.y == maxCell.y) frac[k].y = 0.f;
+            if (i0.z == maxCell.z) frac[k].z = 0.f;
+            result[k] = 0.f;
+          }
+          for (int corner=0;corner<8;corner++) {
+            const vec3i delta(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+            for (size_t k=0;k<count;k++)
+              idx[k] = (int32_t)model.cellIndex(grid,min(maxCell,lower[k]+delta));
+            gather(base,idx.data(),values.data(),count);
+            for (size_t k=0;k<count;k++) {
+              const float w
+                = (delta.x ? frac[k].x : 1.f-frac[k].x)
+                * (delta.y ? frac[k].y : 1.f-frac[k].y)
+                * (delta.z ? frac[k].z : 1.f-frac[k].z);
+              result[k] += w*values[k];
+            }
+          }
+          for (size_t k=0;k<count;k++)
+            out[begin+queries[runBegin+k].pointID] = result[k];
+        }
+        runBegin = runEnd;
+      }
+    },numThreads);
+  }
+
+} // ::tamr
@@ -0,0 +1,62 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/GridIndex.h"
+#include <cmath>
+
+namespace tamr {
+
+  /*! evaluates a model's fields at (many) arbitrary world-space
+      points at once. Each point gets looked up in the finest grid
+      that contains it; queries get grouped by grid, and the scalars
+      get fetched with AVX2/AVX-512 gathers where the CPU has those.
+      Like GridIndex, this refers to the model it was created for. */
+  struct Sampler {
+    typedef std::shared_ptr<Sampler> SP;
+
+    typedef enum {
+      /*! value of the cell that contains the point */
+      FILTER_NEAREST,
+      /*! trilinear interpolation between the cell centers of the
+          finest grid that contains the point; near that grid's
+          boundary this clamps to the grid's outermost cells (see
+          Interpolator for something that's continuous across
+          grids) */
+      FILTER_TRILINEAR,
+    } Filter;
+
+    /*! creates a sampler for given model, building a GridIndex
+        over its grids */
+    Sampler(const Model &model, int numThreads = 0);
+
+    /*! evaluates given dimension of given field at the 'n' given
+        world-space points, writing the values to out[0..n); points
+        that aren't in any grid get 'outside' */
+    void sample(int fieldID, const vec3f *points, float *out, size_t n,
+                int dim = 0) const;
+
+    Filter          filter     = FILTER_NEAREST;
+    /*! value for points that aren't in any grid */
+    float           outside    = NAN;
+    int             numThreads = 0;
+
+    const Model    &model;
+    const GridIndex index;
+  };
+
+} // ::tamr
@@ -0,0 +1,89 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <cstdint>
+
+namespace tamr {
+
+  /*! spreads the lower 21 bits of 'x' out such that there are two
+      zero bits between any two of them */
+  inline uint64_t spreadBits3(uint64_t x)
+  {
+    x &= 0x1fffff;
+    x = (x | (x << 32)) & 0x001f00000000ffffull;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+    x = (x | (x <<  8)) & 0x100f00f00f00f00full;
+    x = (x | (x <<  4)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x <<  2)) & 0x1249249249249249ull;
+    return x;
+  }
+
+  /*! inverse of spreadBits3() */
+  inline uint32_t compactBits3(uint64_t x)
+  {
+    x &= 0x1249249249249249ull;
+    x = (x | (x >>  2)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x >>  4)) & 0x100f00f00f00f00full;
+    x = (x | (x >>  8)) & 0x001f0000ff0000ffull;
+    x = (x | (x >> 16)) & 0x001f00000000ffffull;
+    x = (x | (x >> 32)) & 0x1fffff;
+    return (uint32_t)x;
+  }
+
+  /*! position along the 3D Morton (Z-order) curve of the point with
+      given 21-bit coordinates */
+  inline uint64_t mortonCode3(uint32_t x, uint32_t y, uint32_t z)
+  {
+    return spreadBits3(x) | (spreadBits3(y) << 1) | (spreadBits3(z) << 2);
+  }
+
+  /*! position along the 3D Hilbert curve (of order 'bits', at most
+      21) of the point with given coordinates; this is Skilling's
+      algorithm ("Programming the Hilbert curve", 2004). Unlike the
+      Morton curve, consecutive positions along it are always
+      neighbors. */
+  inline uint64_t hilbertCode3(uint32_t x, uint32_t y, uint32_t z, int bits=21)
+  {
+    uint32_t X[3] = { x, y, z };
+    const uint32_t M = 1u << (bits-1);
+    // inverse undo excess work
+    for (uint32_t Q=M;Q>1;Q>>=1) {
+      const uint32_t P = Q-1;
+      for (int i=0;i<3;i++) {
+        if (X[i] & Q)
+          X[0] ^= P;
+        else {
+          const uint32_t t = (X[0] ^ X[i]) & P;
+          X[0] ^= t;
+          X[i] ^= t;
+        }
+      }
+    }
+    // gray encode
+    X[1] ^= X[0];
+    X[2] ^= X[1];
+    uint32_t t = 0;
+    for (uint32_t Q=M;Q>1;Q>>=1)
+      if (X[2] & Q) t ^= Q-1;
+    for (int i=0;i<3;i++)
+      X[i] ^= t;
+    // X[0] holds the most significant bit of each triple
+    return (spreadBits3(X[0]) << 2) | (spreadBits3(X[1]) << 1) | spreadBits3(X[2]);
+  }
+
+} // ::tamr
@@ -0,0 +1,351 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/TimeSeries.h"
+#include "tinyAMR/Compression.h"
+#include <cstring>
+
+namespace tamr {
+  using namespace tamr::format;
+
+  /*! field metas for scalars stored the way time series store them:
+      all fields in order, without gaps */
+  static std::vector<Model::FieldMeta>
+  packedFieldMetas(const std::vector<Model::FieldMeta> &fields, uint64_t numCells)
+  {
+    std::vector<Model::FieldMeta> packed = fields;
+    uint64_t offset = 0;
+    for (auto &meta : packed) {
+      meta.offset = offset;
+      offset += meta.numDimensions*numCells;
+    }
+    return packed;
+  }
+
+  // ------------------------------------------------------------------
+  // reading
+  // ------------------------------------------------------------------
+
+  TimeSeries::SP TimeSeries::open(const std::string &fileName)
+  {
+    TimeSeries::SP series = std::make_shared<TimeSeries>();
+    series->in.open(fileName,std::ios::binary);
+    if (!series->in.good())
+      throw std::runtime_error("tamr::TimeSeries: could not open '"+fileName+"'");
+    series->layout = readLayout(series->in);
+    series->meta = readMetaData(series->in,series->layout);
+
+    if (const Section *section = series->layout.find(SECTION_TIMESTEPS)) {
+      if (section->size != section->count*sizeof(TimestepInfo))
+        throw std::runtime_error("tamr: inconsistent section size");
+      series->isSeries = true;
+      series->timesteps.resize(section->count);
+      series->in.seekg(section->offset);
+      series->in.read((char*)series->timesteps.data(),section->size);
+    } else {
+      TimestepInfo info = {};
+      info.numCells = series->meta->numCellsAcrossAllGrids;
+      series->timesteps.push_back(info);
+    }
+    uint32_t numTopologies = 0;
+    for (auto &info : series->timesteps)
+      numTopologies = std::max(numTopologies,info.topology+1);
+    series->topologies.resize(numTopologies);
+    if (!series->in.good())
+      throw std::runtime_error("tamr::TimeSeries: error reading '"+fileName+"'");
+    return series;
+  }
+
+  const Array<Model::Grid> &TimeSeries::topology(uint32_t index)
+  {
+    Array<Model::Grid> &grids = topologies.at(index);
+    if (grids.empty()) {
+      // read once, then hand out views that keep this copy alive
+      auto owner = std::make_shared<std::vector<Model::Grid>>();
+      readSection(in,layout.get(SECTION_GRIDS,index),*owner);
+      if (!in.good())
+        throw std::runtime_error("tamr::TimeSeries: error reading grids");
+      grids = Array<Model::Grid>::view(owner->data(),owner->size(),owner);
+    }
+    return grids;
+  }
+
+  Model::SP TimeSeries::load(int timestep)
+  {
+    Model::SP model = std::make_shared<Model>(*meta);
+    load(timestep,*model);
+    return model;
+  }
+
+  void TimeSeries::load(int timestep, Model &model)
+  {
+    if (timestep < 0 || timestep >= (int)timesteps.size())
+      throw std::runtime_error("tamr::TimeSeries: invalid timestep "
+                               +std::to_string(timestep));
+    const TimestepInfo &info = timesteps[timestep];
+    const Array<Model::Grid> &grids = topology(info.topology);
+    if (model.grids.data() != grids.data())
+      model.grids = grids;
+    model.numCellsAcrossAllGrids = info.numCells;
+    model.fieldMetas
+      = isSeries
+      ? packedFieldMetas(meta->fieldMetas,info.numCells)
+      : meta->fieldMetas;
+    const Section &scalars = layout.get(SECTION_SCALARS,timestep);
+    const bool isDelta
+      =  scalars.encoding == ENCODING_TEMPORAL_DELTA
+      || (timestep+1 < (int)timesteps.size() &&
+          layout.get(SECTION_SCALARS,timestep+1).encoding == ENCODING_TEMPORAL_DELTA);
+    if (isDelta) {
+      // part of a chain of deltas; decode through our cache so the
+      // next timestep can be decoded from this one
+      decode(timestep);
+      model.scalars.resize(decoded.size());
+      std::copy(decoded.begin(),decoded.end(),model.scalars.begin());
+    } else {
+      readSection(in,scalars,model.scalars);
+    }
+    if (!in.good())
+      throw std::runtime_error("tamr::TimeSeries: error reading scalars");
+  }
+
+  void TimeSeries::decode(int timestep)
+  {
+    if (decodedTimestep == timestep) return;
+    
+    // go back until either a keyframe, or the timestep we already have
+    int begin = timestep;
+    while (begin != decodedTimestep &&
+           layout.get(SECTION_SCALARS,begin).encoding == ENCODING_TEMPORAL_DELTA) {
+      if (begin == 0)
+        throw std::runtime_error("tamr::TimeSeries: first timestep is a delta");
+      begin--;
+    }
+    if (begin != decodedTimestep) {
+      readSection(in,layout.get(SECTION_SCALARS,begin),decoded);
+      decodedTimestep = begin;
+    }
+
+    std::vector<uint8_t> payload;
+    std::vector<float>   next;
+    for (int t=decodedTimestep+1;t<=timestep;t++) {
+      const Section &section = layout.get(SECTION_SCALARS,t);
+      if (section.count != decoded.size())
+        throw std::runtime_error("tamr::TimeSeries: delta against a different topology");
+      payload.resize(section.size);
+      in.seekg(section.offset);
+      in.read((char*)payload.data(),payload.size());
+      if (!in.good())
+        throw std::runtime_error("tamr::TimeSeries: error reading scalars");
+      next.resize(section.count);
+      decodeTemporalDelta(section,payload.data(),decoded.data(),next.data(),numThreads);
+      decoded.swap(next);
+      decodedTimestep = t;
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // writing
+  // ------------------------------------------------------------------
+
+  TimeSeriesWriter::TimeSeriesWriter(const std::string &fileName,
+                                     int keyframeInterval)
+    : fileName(fileName),
+      out(fileName,std::ios::binary),
+      keyframeInterval(keyframeInterval)
+  {
+    if (!out.good())
+      throw std::runtime_error("tamr::TimeSeriesWriter: could not open '"
+                               +fileName+"' for writing");
+    // placeholder for the header; the TOC goes at the end
+    const Header header = {};
+    out.write((const char *)&header,sizeof(header));
+    pos = sizeof(header);
+  }
+
+  TimeSeriesWriter::~TimeSeriesWriter()
+  {
+    if (closed) return;
+    try {
+      close();
+    } catch (std::exception &e) {
+      std::cerr << "tamr::TimeSeriesWriter: " << e.what() << std::endl;
+    }
+  }
+
+  void TimeSeriesWriter::beginSection(uint32_t type, uint32_t index,
+                                      uint64_t size, uint64_t count)
+  {
+    static const char zeroes[pageSize] = {};
+    const uint64_t begin = alignUp(pos,alignmentFor(size));
+    out.write(zeroes,begin-pos);
+    Section section = {};
+    section.type   = type;
+    section.index  = index;
+    section.offset = begin;
+    section.size   = size;
+    section.count  = count;
+    sections.push_back(section);
+    pos = begin;
+  }
+
+  void TimeSeriesWriter::writeSection(uint32_t type, uint32_t index,
+                                      const void *data, uint64_t size, uint64_t count)
+  {
+    beginSection(type,index,size,count);
+    out.write((const char *)data,size);
+    pos += size;
+  }
+
+  void TimeSeriesWriter::add(const Model &model, double time)
+  {
+    if (closed)
+      throw std::runtime_error("tamr::TimeSeriesWriter: already closed");
+    if (timesteps.empty()) {
+      shared.refinementOfLevel = model.refinementOfLevel;
+      shared.fieldMetas        = model.fieldMetas;
+      shared.userMeta          = model.userMeta;
+      shared.gridOrigin        = model.gridOrigin;
+      shared.gridOffset        = model.gridOffset;
+      shared.cellLayout        = model.cellLayout;
+    } else {
+      bool sameFields = (model.fieldMetas.size() == shared.fieldMetas.size());
+      for (size_t i=0;sameFields && i<model.fieldMetas.size();i++)
+        sameFields
+          =  model.fieldMetas[i].name == shared.fieldMetas[i].name
+          && model.fieldMetas[i].numDimensions == shared.fieldMetas[i].numDimensions;
+      if (!sameFields)
+        throw std::runtime_error("tamr::TimeSeriesWriter: all timesteps need the same fields");
+      if (model.cellLayout != shared.cellLayout)
+        throw std::runtime_error("tamr::TimeSeriesWriter: all timesteps need the same cell layout");
+    }
+
+    const bool sameGrids
+      =  !timesteps.empty()
+      && model.grids.size() == prevGrids.size()
+      && !memcmp(model.grids.data(),prevGrids.data(),prevGrids.size()*sizeof(Model::Grid));
+    if (!sameGrids) {
+      writeSection(SECTION_GRIDS,numTopologies++,model.grids.data(),
+                   model.grids.size()*sizeof(Model::Grid),model.grids.size());
+      prevGrids.assign(model.grids.begin(),model.grids.end());
+    }
+
+    // scalars, with fields packed in order
+    const uint64_t numCells = model.numCellsAcrossAllGrids;
+    uint64_t numScalars = 0;
+    for (auto &meta : model.fieldMetas) {
+      if (meta.offset+meta.numDimensions*numCells > model.scalars.size())
+        throw std::runtime_error("tamr::TimeSeriesWriter: field '"+meta.name
+                                 +"' exceeds the model's scalars");
+      numScalars += meta.numDimensions*numCells;
+    }
+    const uint32_t timestep = (uint32_t)timesteps.size();
+    if (keyframeInterval <= 0) {
+      beginSection(SECTION_SCALARS,timestep,numScalars*sizeof(float),numScalars);
+      for (auto &meta : model.fieldMetas)
+        out.write((const char *)(model.scalars.data()+meta.offset),
+                  meta.numDimensions*numCells*sizeof(float));
+      pos += numScalars*sizeof(float);
+    } else {
+      std::vector<float> packed;
+      packed.reserve(numScalars);
+      for (auto &meta : model.fieldMetas)
+        packed.insert(packed.end(),
+                      model.scalars.data()+meta.offset,
+                      model.scalars.data()+meta.offset+meta.numDimensions*numCells);
+      const bool keyframe = !sameGrids || sinceKeyframe >= keyframeInterval;
+      const std::string payload
+        = keyframe
+        ? encodeLossless(packed.data(),numScalars)
+        : encodeTemporalDelta(packed.data(),prevScalars.data(),numScalars);
+      writeSection(SECTION_SCALARS,timestep,payload.data(),payload.size(),numScalars);
+      sections.back().encoding
+        = keyframe ? ENCODING_LOSSLESS : ENCODING_TEMPORAL_DELTA;
+      sinceKeyframe = keyframe ? 1 : sinceKeyframe+1;
+      prevScalars.swap(packed);
+    }
+
+    TimestepInfo info = {};
+    info.time     = time;
+    info.topology = numTopologies-1;
+    info.numCells = numCells;
+    timesteps.push_back(info);
+    if (!out.good())
+      throw std::runtime_error("tamr::TimeSeriesWriter: error writing '"+fileName+"'");
+  }
+
+  void TimeSeriesWriter::close()
+  {
+    closed = true;
+    if (timesteps.empty())
+      throw std::runtime_error("tamr::TimeSeriesWriter: no timesteps");
+    const uint64_t numCells0 = timesteps[0].numCells;
+    const std::vector<Model::FieldMeta> fieldMetas
+      = packedFieldMetas(shared.fieldMetas,numCells0);
+
+    writeSection(SECTION_REFINEMENT_OF_LEVEL,0,shared.refinementOfLevel.data(),
+                 shared.refinementOfLevel.size()*sizeof(int),
+                 shared.refinementOfLevel.size());
+    const std::string metas = serializeFieldMetas(fieldMetas);
+    writeSection(SECTION_FIELD_METAS,0,metas.data(),metas.size(),fieldMetas.size());
+    writeSection(SECTION_USER_META,0,shared.userMeta.data(),
+                 shared.userMeta.size(),shared.userMeta.size());
+    writeSection(SECTION_TIMESTEPS,0,timesteps.data(),
+                 timesteps.size()*sizeof(TimestepInfo),timesteps.size());
+
+    // so regular readers see the first timestep as a regular model
+    Section scalars0 = {};
+    for (auto &section : sections)
+      if (section.type == SECTION_SCALARS && section.index == 0)
+        scalars0 = section;
+    for (size_t fieldID=0;fieldID<fieldMetas.size();fieldID++) {
+      Section section = {};
+      section.type   = SECTION_FIELD_SCALARS;
+      section.index  = (uint32_t)fieldID;
+      section.begin  = fieldMetas[fieldID].offset;
+      section.count  = fieldMetas[fieldID].numDimensions*numCells0;
+      if (scalars0.encoding == ENCODING_RAW) {
+        section.offset = scalars0.offset + section.begin*sizeof(float);
+        section.size   = section.count*sizeof(float);
+      } else {
+        // encoded scalars can't be addressed by byte offset; only
+        // 'begin' and 'count' are meaningful
+        section.offset = scalars0.offset;
+        section.size   = 0;
+      }
+      sections.push_back(section);
+    }
+
+    Header header = {};
+    header.magic       = magic;
+    header.version     = version;
+    header.numSections = (uint32_t)sections.size();
+    header.tocOffset   = alignUp(pos,sectionAlignment);
+    header.numCellsAcrossAllGrids = numCells0;
+    header.gridOrigin  = shared.gridOrigin;
+    header.gridOffset  = shared.gridOffset;
+    header.cellLayout  = shared.cellLayout;
+    static const char zeroes[sectionAlignment] = {};
+    out.write(zeroes,header.tocOffset-pos);
+    out.write((const char *)sections.data(),sections.size()*sizeof(Section));
+    out.seekp(0);
+    out.write((const char *)&header,sizeof(header));
+    out.close();
+    if (out.fail())
+      throw std::runtime_error("tamr::TimeSeriesWriter: error writing '"+fileName+"'");
+  }
+
+} // ::tamr
@@ -0,0 +1,147 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! \file TimeSeries.h multiple timesteps of the same simulation in a
+    single .tamr file.
+
+    All timesteps share refinementOfLevel, field names, user meta
+    and grid origin/offset; each timestep has its own SCALARS section
+    (with the section index being the timestep), and a grid topology
+    (GRIDS section) that it shares with all other timesteps whose
+    grids are the same. Within each timestep's scalars, fields are
+    stored in order, without gaps, one dimension after another.
+
+    Optionally, timesteps can be delta-encoded: every so many
+    timesteps (and whenever the topology changes) there's a keyframe
+    whose scalars are compressed lossless on their own; all other
+    timesteps store the (compressed) bitwise difference to the
+    timestep before them.
+
+    A time series file is also a valid regular .tamr file, which
+    Model::load() et al will read as its first timestep. */
+
+#pragma once
+
+#include "tinyAMR/FileFormat.h"
+#include <fstream>
+
+namespace tamr {
+
+  /*! reads a time series, one timestep at a time */
+  struct TimeSeries {
+    typedef std::shared_ptr<TimeSeries> SP;
+
+    /*! opens given file, and reads everything except grids and
+        scalars. Regular (single-timestep) .tamr files can be opened
+        as well, and then have one timestep */
+    static TimeSeries::SP open(const std::string &fileName);
+
+    size_t numTimesteps() const { return timesteps.size(); }
+
+    /*! simulation time of given timestep */
+    double time(int timestep) const { return timesteps.at(timestep).time; }
+
+    /*! returns a new model for given timestep. Its grids are a view
+        that is shared by all models of this series that use the same
+        topology */
+    Model::SP load(int timestep);
+
+    /*! switches 'model' - which must be a model returned by load() -
+        to given timestep: this reads only that timestep's scalars
+        (re-using the model's scalars array), and switches grids only
+        if the new timestep has a different topology. For
+        delta-encoded timesteps this needs the previous timestep's
+        scalars: stepping forward one timestep at a time only decodes
+        one delta per step; anything else decodes all deltas since the
+        last keyframe */
+    void load(int timestep, Model &model);
+
+    /*! number of threads used to decode scalars; 0 means all */
+    int numThreads = 0;
+
+    /*! everything the timesteps share; ie, a model without grids and
+        scalars */
+    Model::SP meta;
+
+    std::vector<format::TimestepInfo> timesteps;
+
+  private:
+    /*! the grids of given topology, read once and then shared */
+    const Array<Model::Grid> &topology(uint32_t index);
+
+    std::ifstream                    in;
+    format::Layout                   layout;
+    std::vector<Array<Model::Grid>>  topologies;
+    /*! makes 'decoded' hold given timestep's scalars */
+    void decode(int timestep);
+
+    /*! the most recently decoded timestep (of delta-encoded series) */
+    std::vector<float>               decoded;
+    int                              decodedTimestep = -1;
+    /*! whether this is an actual time series, or a regular file */
+    bool                             isSeries = false;
+  };
+
+  /*! writes a time series; timesteps get appended one at a time, and
+      only need to be in memory while add() runs */
+  struct TimeSeriesWriter {
+    /*! creates a writer; if 'keyframeInterval' is non-zero, scalars
+        get delta-encoded, with a keyframe (at least) every that many
+        timesteps */
+    TimeSeriesWriter(const std::string &fileName, int keyframeInterval = 0);
+
+    /*! closes the file if not already done */
+    ~TimeSeriesWriter();
+
+    /*! appends given model as the next timestep. All timesteps need
+        to have the same fields (by name and number of dimensions)
+        and the same cell layout; refinementOfLevel, user meta, and grid origin/offset get
+        taken from the first timestep. The model's grids get stored
+        only if they differ from the previous timestep's */
+    void add(const Model &model, double time);
+
+    /*! writes the table of contents and closes the file */
+    void close();
+
+  private:
+    /*! adds a TOC entry for a section of given size at the next
+        aligned position, and pads the file up to there; the caller
+        then has to write the payload */
+    void beginSection(uint32_t type, uint32_t index,
+                      uint64_t size, uint64_t count);
+    
+    /*! appends a section with given payload at the next aligned
+        position */
+    void writeSection(uint32_t type, uint32_t index,
+                      const void *data, uint64_t size, uint64_t count);
+
+    std::string                       fileName;
+    std::ofstream                     out;
+    uint64_t                          pos = 0;
+    std::vector<format::Section>      sections;
+    std::vector<format::TimestepInfo> timesteps;
+    /*! the first timestep, minus its grids and scalars */
+    Model                             shared;
+    std::vector<Model::Grid>          prevGrids;
+    const int                         keyframeInterval;
+    int                               sinceKeyframe = 0;
+    /*! for delta encoding: previous timestep's (packed) scalars */
+    std::vector<float>                prevScalars;
+    uint32_t                          numTopologies = 0;
+    bool                              closed = false;
+  };
+
+} // ::tamr
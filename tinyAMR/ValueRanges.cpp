@@ -0,0 +1,172 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "tinyAMR/ValueRanges.h"
+#include "tinyAMR/QuantizedField.h"
+#include "tinyAMR/parallel_for.h"
+#include <fstream>
+#include <cmath>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace tamr {
+  using namespace tamr::format;
+
+  range1f computeRange(const float *values, size_t count)
+  {
+    float lo = INFINITY, hi = -INFINITY;
+    size_t i = 0;
+#if defined(__SSE2__)
+    // min/max_ps return their second operand if either is NaN, so
+    // with the value first NaNs get skipped
+    __m128 lo4[2] = { _mm_set1_ps(INFINITY),  _mm_set1_ps(INFINITY) };
+    __m128 hi4[2] = { _mm_set1_ps(-INFINITY), _mm_set1_ps(-INFINITY) };
+    for (;i+8<=count;i+=8) {
+      const __m128 a = _mm_loadu_ps(values+i);
+      const __m128 b = _mm_loadu_ps(values+i+4);
+      lo4[0] = _mm_min_ps(a,lo4[0]);
+      lo4[1] = _mm_min_ps(b,lo4[1]);
+      hi4[0] = _mm_max_ps(a,hi4[0]);
+      hi4[1] = _mm_max_ps(b,hi4[1]);
+    }
+    float l[4], h[4];
+    _mm_storeu_ps(l,_mm_min_ps(lo4[0],lo4[1]));
+    _mm_storeu_ps(h,_mm_max_ps(hi4[0],hi4[1]));
+    for (int k=0;k<4;k++) {
+      lo = std::min(lo,l[k]);
+      hi = std::max(hi,h[k]);
+    }
+#endif
+    for (;i<count;i++) {
+      if (values[i] < lo) lo = values[i];
+      if (values[i] > hi) hi = values[i];
+    }
+    return lo <= hi ? range1f(lo,hi) : range1f();
+  }
+
+  ValueRanges::SP ValueRanges::compute(const Model &model, int fieldID, int numThreads)
+  {
+    const Model::FieldMeta &meta = model.fieldMetas.at(fieldID);
+    ValueRanges::SP result = std::make_shared<ValueRanges>();
+    result->numGrids      = model.grids.size();
+    result->numDimensions = meta.numDimensions;
+    result->ranges.resize(result->numGrids*meta.numDimensions);
+    parallel_for(result->numGrids,[&](size_t gridID) {
+      const Model::Grid &grid = model.grids[gridID];
+      const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+      for (int dim=0;dim<meta.numDimensions;dim++) {
+        const uint64_t begin = meta.offset+dim*model.numCellsAcrossAllGrids+grid.offset;
+        if (begin+numCells > model.scalars.size())
+          throw std::runtime_error("tamr::ValueRanges: grid exceeds the model's scalars");
+        result->ranges[dim*result->numGrids+gridID]
+          = computeRange(model.scalars.data()+begin,numCells);
+      }
+    },numThreads);
+    return result;
+  }
+
+  ValueRanges::SP ValueRanges::load(const std::string &fileName,
+                                    const std::string &fieldName)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    if (!in.good())
+      throw std::runtime_error("tamr::ValueRanges: could not open '"+fileName+"'");
+    Layout layout = readLayout(in);
+    in.seekg(layout.get(SECTION_FIELD_METAS).offset);
+    const std::vector<Model::FieldMeta> fieldMetas = readFieldMetas(in);
+    for (size_t fieldID=0;fieldID<fieldMetas.size();fieldID++) {
+      if (fieldMetas[fieldID].name != fieldName) continue;
+      const Section *section = layout.find(SECTION_VALUE_RANGES,(uint32_t)fieldID);
+      if (!section) return {};
+      ValueRanges::SP result = std::make_shared<ValueRanges>();
+      result->numDimensions = std::max(1,fieldMetas[fieldID].numDimensions);
+      result->numGrids      = section->count/result->numDimensions;
+      readSection(in,*section,result->ranges);
+      if (!in.good())
+        throw std::runtime_error("tamr::ValueRanges: error reading '"+fileName+"'");
+      return result;
+    }
+    throw std::runtime_error("tamr::ValueRanges: file '"+fileName
+                             +"' does not contain a field named '"+fieldName+"'");
+  }
+
+  range1f ValueRanges::overall(int dim) const
+  {
+    range1f result;
+    for (size_t gridID=0;gridID<numGrids;gridID++)
+      if (!of(gridID,dim).empty())
+        result.extend(of(gridID,dim));
+    return result;
+  }
+
+  namespace format {
+
+    void addValueRanges(FilePlan &plan, const Model &model,
+                        const IOOptions &options)
+    {
+      for (size_t fieldID=0;fieldID<model.fieldMetas.size();fieldID++) {
+        ValueRanges::SP ranges = ValueRanges::compute(model,(int)fieldID,options.numThreads);
+        const std::string &name = model.fieldMetas[fieldID].name;
+        const bool lossy = (options.compression == IOOptions::COMPRESSION_LOSSY);
+        auto quantized = options.quantizedFields.find(name);
+        auto it = options.errorBounds.find(name);
+        if (lossy && quantized != options.quantizedFields.end()) {
+          // (same precedence as in compressScalarsLossy) fp16 and bf16
+          // round to nearest, so decoded values may lie outside the
+          // original ones' range: use the range of what gets decoded,
+          // quantizing each grid exactly like its chunk does
+          const QuantizedField::Format format = (QuantizedField::Format)quantized->second;
+          const Model::FieldMeta &meta = model.fieldMetas[fieldID];
+          parallel_for(model.grids.size(),[&](size_t gridID) {
+            const Model::Grid &grid = model.grids[gridID];
+            const uint64_t numCells = uint64_t(grid.dims.x)*grid.dims.y*grid.dims.z;
+            std::vector<uint8_t> quantizedValues(numCells*QuantizedField::bytesPerScalar(format));
+            std::vector<float>   decoded(numCells);
+            for (int dim=0;dim<meta.numDimensions;dim++) {
+              const float *values = model.scalars.data()+meta.offset
+                +dim*model.numCellsAcrossAllGrids+grid.offset;
+              QuantizedField::GridRange range = { 0.f, 0.f };
+              QuantizedField::quantize(format,values,numCells,quantizedValues.data(),range);
+              QuantizedField::dequantize(format,quantizedValues.data(),numCells,
+                                         decoded.data(),range);
+              ranges->ranges[dim*ranges->numGrids+gridID]
+                = computeRange(decoded.data(),numCells);
+            }
+          },options.numThreads);
+        } else if (lossy && it != options.errorBounds.end() && it->second.value > 0.f) {
+          // lossy values may be off by up to the error bound
+          float bound = it->second.value;
+          if (it->second.relative) {
+            range1f all;
+            for (int dim=0;dim<ranges->numDimensions;dim++)
+              if (!ranges->overall(dim).empty())
+                all.extend(ranges->overall(dim));
+            bound *= all.empty() ? 0.f : all.upper-all.lower;
+          }
+          for (auto &range : ranges->ranges)
+            if (!range.empty())
+              range = range1f(range.lower-bound,range.upper+bound);
+        }
+        plan.add(SECTION_VALUE_RANGES,(uint32_t)fieldID,
+                 std::string((const char *)ranges->ranges.data(),
+                             ranges->ranges.size()*sizeof(range1f)),
+                 ranges->ranges.size());
+      }
+    }
+
+  }
+} // ::tamr
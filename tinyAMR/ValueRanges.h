@@ -0,0 +1,68 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "tinyAMR/FileFormat.h"
+
+namespace tamr {
+
+  /*! the range of values of each grid's scalars of one field (for
+      each dimension of that field), so that apps can skip grids -
+      eg, for iso-surface extraction or transfer function culling -
+      without ever touching their scalars. NaNs are ignored; a grid
+      with only NaNs has an empty range. These can be stored in .tamr
+      files (see IOOptions::storeValueRanges), and read from there
+      without reading any scalars. */
+  struct ValueRanges {
+    typedef std::shared_ptr<ValueRanges> SP;
+
+    /*! computes the ranges of given field of given model, with the
+        grids getting processed in parallel */
+    static SP compute(const Model &model, int fieldID, int numThreads = 0);
+
+    /*! reads the ranges of the field with given name from given
+        file; returns null if the file doesn't store any for it */
+    static SP load(const std::string &fileName, const std::string &fieldName);
+
+    /*! range of given grid's values, in given dimension */
+    const range1f &of(size_t gridID, int dim = 0) const
+    { return ranges[dim*numGrids+gridID]; }
+
+    /*! range of all values of given dimension */
+    range1f overall(int dim = 0) const;
+
+    size_t               numGrids      = 0;
+    int                  numDimensions = 1;
+    /*! all grids' ranges of dimension 0, then of dimension 1, etc */
+    std::vector<range1f> ranges;
+  };
+
+  /*! range of the non-NaN values in values[0..count); empty if there
+      are none */
+  range1f computeRange(const float *values, size_t count);
+
+  namespace format {
+    /*! adds a VALUE_RANGES section for each field of the given model
+        to the given plan (which must be the plan of that model). For
+        fields that get stored lossy, the ranges get widened by the
+        respective error bound; for quantized fields they are the
+        ranges of the dequantized values */
+    void addValueRanges(FilePlan &plan, const Model &model,
+                        const IOOptions &options);
+  }
+
+} // ::tamr
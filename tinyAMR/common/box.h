@@ -270,5 +270,8 @@ namespace tamr {
   
 #undef _define_box_types
 
+    typedef interval<float>   range1f;
+    typedef interval<int32_t> range1i;
+
   } // ::tamr::common
 } // ::owl
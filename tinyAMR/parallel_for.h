@@ -0,0 +1,77 @@
+// ======================================================================== //
+// Copyright 2025++ Ingo Wald                                               //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+namespace tamr {
+
+  /*! number of threads to actually use when asked for 'requested'
+      threads, where 0 means 'as many as the machine has' */
+  inline int numThreadsToUse(int requested)
+  {
+    if (requested > 0) return requested;
+    return std::max(1,(int)std::thread::hardware_concurrency());
+  }
+
+  /*! calls lambda(jobID) for all jobIDs in [0,numJobs), using up to
+      'numThreads' threads (0 meaning all hardware threads). Jobs get
+      handed out dynamically, so they need not be of equal cost. If
+      any job throws, remaining jobs get skipped, and the first
+      exception gets re-thrown in the calling thread. */
+  template<typename Lambda>
+  void parallel_for(size_t numJobs, const Lambda &lambda, int numThreads=0)
+  {
+    numThreads = (int)std::min((size_t)numThreadsToUse(numThreads),numJobs);
+    if (numThreads <= 1) {
+      for (size_t jobID=0;jobID<numJobs;jobID++)
+        lambda(jobID);
+      return;
+    }
+
+    std::atomic<size_t> nextJob(0);
+    std::exception_ptr  error;
+    std::mutex          errorMutex;
+    auto worker = [&]() {
+      while (true) {
+        size_t jobID = nextJob++;
+        if (jobID >= numJobs) return;
+        try {
+          lambda(jobID);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!error) error = std::current_exception();
+          nextJob = numJobs;
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int i=1;i<numThreads;i++)
+      threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+      thread.join();
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+} // ::tamr